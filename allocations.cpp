@@ -0,0 +1,24 @@
+#include <cstdlib>
+#include <new>
+#include "driver/Stats.h"
+
+/*
+ * Counting replacements of the global allocation functions, for the
+ * phases of --stats; the array and sized variants of new/delete end up
+ * here as well. Only the kompilator executable is linked with them, so
+ * libkompilator.a doesn't take over its host's allocations.
+ */
+void *operator new(size_t size) {
+    Stats::allocated(size);
+
+    if (void *pointer = malloc(size ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    operator delete(pointer);
+}
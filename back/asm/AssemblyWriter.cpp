@@ -0,0 +1,126 @@
+#include "AssemblyWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+AssemblyWriter::AssemblyWriter(const std::string &path, bool memoryMapped) : path(path), memoryMapped(memoryMapped) {
+    descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0) throw "Can't open " + path + ": " + strerror(errno);
+
+    if (memoryMapped) {
+        map(INITIAL_MAPPING_SIZE);
+    } else {
+        buffer = new char[BUFFER_SIZE];
+        capacity = BUFFER_SIZE;
+    }
+}
+
+AssemblyWriter::AssemblyWriter(std::string *target) : target(target) {
+    buffer = new char[BUFFER_SIZE];
+    capacity = BUFFER_SIZE;
+}
+
+void AssemblyWriter::map(size_t size) {
+    if (buffer) munmap(buffer, capacity);
+    buffer = nullptr;
+
+    if (ftruncate(descriptor, size) < 0) throw "Can't resize " + path + ": " + strerror(errno);
+
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    if (mapping == MAP_FAILED) throw "Can't map " + path + ": " + strerror(errno);
+
+    buffer = static_cast<char *>(mapping);
+    capacity = size;
+}
+
+void AssemblyWriter::flush() {
+    if (target) {
+        target->append(buffer, used);
+        used = 0;
+        return;
+    }
+
+    size_t written = 0;
+    while (written < used) {
+        ssize_t result = write(descriptor, buffer + written, used - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            throw "Can't write to " + path + ": " + strerror(errno);
+        }
+        written += result;
+    }
+    used = 0;
+}
+
+void AssemblyWriter::reserve() {
+    if (used + MAX_LINE_LENGTH <= capacity) return;
+
+    if (memoryMapped) {
+        map(capacity * 2); // the written part is already in the file
+    } else {
+        flush();
+    }
+}
+
+void AssemblyWriter::instruction(const char *mnemonic) {
+    reserve();
+
+    size_t length = strlen(mnemonic);
+    memcpy(buffer + used, mnemonic, length);
+    used += length;
+    buffer[used++] = '\n';
+}
+
+void AssemblyWriter::instruction(const char *mnemonic, long long argument) {
+    reserve();
+
+    size_t length = strlen(mnemonic);
+    memcpy(buffer + used, mnemonic, length);
+    used += length;
+    buffer[used++] = ' ';
+    used = std::to_chars(buffer + used, buffer + capacity, argument).ptr - buffer;
+    buffer[used++] = '\n';
+}
+
+void AssemblyWriter::code(std::string_view code) {
+    while (!code.empty()) {
+        reserve();
+
+        size_t length = std::min(code.size(), capacity - used);
+        memcpy(buffer + used, code.data(), length);
+        used += length;
+        code.remove_prefix(length);
+    }
+}
+
+void AssemblyWriter::close() {
+    if (target) {
+        flush();
+        target = nullptr;
+        return;
+    }
+    if (descriptor < 0) return;
+
+    if (memoryMapped) {
+        munmap(buffer, capacity);
+        buffer = nullptr;
+        if (ftruncate(descriptor, used) < 0) throw "Can't resize " + path + ": " + strerror(errno); // cut the unused part of the mapping off
+    } else {
+        flush();
+    }
+
+    ::close(descriptor);
+    descriptor = -1;
+}
+
+AssemblyWriter::~AssemblyWriter() {
+    if (descriptor >= 0) {
+        if (memoryMapped && buffer) munmap(buffer, capacity);
+        ::close(descriptor);
+    }
+    if (!memoryMapped) delete[] buffer;
+}
@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifndef COMPILER_ASSEMBLYWRITER_H
+#define COMPILER_ASSEMBLYWRITER_H
+
+/**
+ * Writes assembly code to a file. Instructions are formatted straight
+ * into a large buffer (no temporary strings), which is written out
+ * with a single syscall whenever it fills up; optionally the output
+ * file is memory-mapped and written to directly instead. The code may
+ * also be collected in a string, with no file I/O at all.
+ */
+class AssemblyWriter {
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+    static const size_t INITIAL_MAPPING_SIZE = 1 << 20;
+
+    /**
+     * Longest possible line: the longest mnemonic, a space, a 64-bit
+     * number and a newline.
+     */
+    static const size_t MAX_LINE_LENGTH = 32;
+
+    std::string path;
+    int descriptor = -1;
+    bool memoryMapped = false;
+
+    /**
+     * String the code is collected in, or nullptr when writing to a file.
+     */
+    std::string *target = nullptr;
+
+    char *buffer = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+
+    /**
+     * Makes room for at least MAX_LINE_LENGTH bytes; flushes the buffer
+     * or grows the mapped file.
+     */
+    void reserve();
+
+    void flush();
+
+    void map(size_t size);
+
+public:
+    /**
+     * Opens (creating or truncating) the output file.
+     * @param path Output file.
+     * @param memoryMapped Write through a memory mapping of the file
+     * instead of a buffer.
+     */
+    AssemblyWriter(const std::string &path, bool memoryMapped = false);
+
+    /**
+     * Appends the code to a string instead of a file.
+     * @param target String to append to; has to outlive the writer.
+     */
+    explicit AssemblyWriter(std::string *target);
+
+    AssemblyWriter(const AssemblyWriter &) = delete;
+
+    AssemblyWriter &operator=(const AssemblyWriter &) = delete;
+
+    /**
+     * Writes a line with an instruction without an argument, e.g. GET.
+     */
+    void instruction(const char *mnemonic);
+
+    /**
+     * Writes a line with an instruction and its argument, e.g. LOAD 10.
+     */
+    void instruction(const char *mnemonic, long long argument);
+
+    /**
+     * Writes already formatted code, e.g. a whole cached program.
+     */
+    void code(std::string_view code);
+
+    /**
+     * Writes everything that's left and closes the file (or finishes
+     * the string).
+     */
+    void close();
+
+    ~AssemblyWriter();
+};
+
+#endif //COMPILER_ASSEMBLYWRITER_H
@@ -2,11 +2,11 @@
 
 InstructionList::InstructionList() {
     afterLast = new Stub();
-    instructions.push_back(afterLast);
+    first = last = afterLast;
 }
 
-std::vector<Instruction *> &InstructionList::getInstructions() {
-    return instructions;
+InstructionList::Range InstructionList::getInstructions() {
+    return Range(first);
 }
 
 Stub *InstructionList::end() {
@@ -14,28 +14,129 @@ Stub *InstructionList::end() {
 }
 
 Instruction *InstructionList::start() {
-    if (instructions.size() == 1) throw "Add something to the instruction list before asking for the start element";
-    return instructions.front();
+    if (first == afterLast) throw "Add something to the instruction list before asking for the start element";
+    return first;
+}
+
+void InstructionList::markDirty(Instruction *instruction) {
+    if (!instruction) return;
+
+    // stubs share their address with the instruction after them, so go back to the first one of such group
+    while (instruction->previous && instruction->previous->getAddress() == instruction->getAddress() && instruction->getAddress() != -1) {
+        instruction = instruction->previous;
+    }
+
+    if (!dirty) {
+        dirty = instruction;
+    } else if (instruction->getAddress() != -1 && (dirty->getAddress() == -1 || instruction->getAddress() < dirty->getAddress())) {
+        dirty = instruction; // instructions without an address were appended after every sealed one
+    }
 }
 
 InstructionList &InstructionList::append(InstructionList &list) {
-    instructions.insert(instructions.end() - 1, list.instructions.begin(), list.instructions.end());
+    Instruction *listFirst = list.first;
+    Instruction *listLast = list.last;
+
+    listFirst->previous = afterLast->previous; // maintain the stub end
+    listLast->next = afterLast;
+    if (afterLast->previous) afterLast->previous->next = listFirst;
+    else first = listFirst;
+    afterLast->previous = listLast;
+
+    if (!dirty) dirty = listFirst;
     return *this;
 }
 
+InstructionList &InstructionList::append(Instruction *instruction) {
+    instruction->previous = afterLast->previous; // maintain the stub end
+    instruction->next = afterLast;
+    if (afterLast->previous) afterLast->previous->next = instruction;
+    else first = instruction;
+    afterLast->previous = instruction;
+
+    if (!dirty) dirty = instruction;
+    return *this;
+}
+
+void InstructionList::remove(Instruction *instruction) {
+    if (instruction == afterLast) throw "Can't remove the end of an instruction list";
+
+    if (dirty == instruction) dirty = instruction->next;
+    markDirty(instruction->next);
+
+    if (instruction->previous) instruction->previous->next = instruction->next;
+    else first = instruction->next;
+    if (instruction->next) instruction->next->previous = instruction->previous;
+    else last = instruction->previous;
+
+    instruction->previous = instruction->next = nullptr;
+}
+
+void InstructionList::replace(Instruction *instruction, Instruction *replacement) {
+    replacement->previous = instruction->previous;
+    replacement->next = instruction->next;
+    if (instruction->previous) instruction->previous->next = replacement;
+    else first = replacement;
+    if (instruction->next) instruction->next->previous = replacement;
+    else last = replacement;
+
+    replacement->setAddress(instruction->getAddress());
+    if (dirty == instruction) dirty = replacement;
+
+    instruction->previous = instruction->next = nullptr;
+}
+
+void InstructionList::relink(const std::vector<Instruction *> &sequence) {
+    for (Instruction *ins = first; ins;) {
+        Instruction *next = ins->next;
+        ins->previous = ins->next = nullptr;
+        ins = next;
+    }
+
+    Instruction *previous = nullptr;
+    for (const auto &ins : sequence) {
+        ins->previous = previous;
+        if (previous) previous->next = ins;
+        else first = ins;
+        previous = ins;
+    }
+
+    afterLast->previous = previous;
+    if (previous) previous->next = afterLast;
+    else first = afterLast;
+    last = afterLast;
+
+    dirty = first;
+}
+
 void InstructionList::seal(bool addHalt) {
-    if (addHalt) instructions.push_back(new Halt());
+    if (addHalt) { // halt goes after the end stub, so jumps to the end still land on it
+        Halt *halt = new Halt();
+        halt->previous = last;
+        last->next = halt;
+        last = halt;
+        if (!dirty) dirty = halt;
+    }
+
+    if (!dirty) return;
 
     long long counter = 0;
-    for (const auto &ins : instructions) { // instruction address resolution
+    if (dirty->previous) {
+        counter = dirty->previous->getAddress() + (dirty->previous->stub ? 0 : 1);
+    }
+
+    for (Instruction *ins = dirty; ins; ins = ins->next) { // instruction address resolution
         ins->setAddress(counter);
         if (!ins->stub) {
             counter++; // stubs use next instruction's address
         }
     }
+
+    dirty = nullptr;
 }
 
-InstructionList &InstructionList::append(Instruction *instruction) {
-    instructions.insert(instructions.end() - 1, instruction); // maintain the stub end
-    return *this;
-}
\ No newline at end of file
+void InstructionList::emit(AssemblyWriter &writer) {
+    for (Instruction *ins = first; ins; ins = ins->next) {
+        if (!ins->stub) ins->emit(writer);
+    }
+}
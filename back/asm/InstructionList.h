@@ -9,26 +9,106 @@
  * single instructions and other lists to its end as well as
  * getting the last element (represented by a Stub instruction
  * object) for the sake of jumps.
+ * Instructions are linked with each other directly (see
+ * Instruction::previous and Instruction::next), so appending a whole
+ * list - which the AbstractAssembler does for every nested block -
+ * only relinks its ends instead of copying it, and an instruction
+ * stays the very same object (and a valid jump target) wherever it
+ * ends up.
  */
-class InstructionList {
+class InstructionList : public ArenaObject {
 private:
+    Instruction *first;
+    Instruction *last;
     Stub *afterLast;
-    std::vector<Instruction *> instructions;
+
+    /**
+     * The earliest instruction whose address may be out of date; seal
+     * starts from here instead of from the start of the program.
+     */
+    Instruction *dirty = nullptr;
+
+    void markDirty(Instruction *instruction);
+
 public:
+    /**
+     * Walks the instructions of a list in their order.
+     */
+    class Iterator {
+    private:
+        Instruction *current;
+    public:
+        Iterator(Instruction *instruction) : current(instruction) {}
+
+        Instruction *operator*() const { return current; }
+
+        Iterator &operator++() {
+            current = current->next;
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) const { return current != other.current; }
+    };
+
+    /**
+     * A view on list's instructions usable in range-for loops.
+     */
+    class Range {
+    private:
+        Instruction *from;
+    public:
+        Range(Instruction *from) : from(from) {}
+
+        Iterator begin() const { return Iterator(from); }
+
+        Iterator end() const { return Iterator(nullptr); }
+    };
+
     Stub *end();
     Instruction *start();
 
-    std::vector<Instruction *> &getInstructions();
+    Range getInstructions();
 
+    /**
+     * Moves all instructions of another list to the end of this one
+     * (before its end Stub) in constant time. The other list's start()
+     * and end() remain valid jump targets, but the list itself shouldn't
+     * be appended anywhere again.
+     */
     InstructionList &append(InstructionList &list);
 
     InstructionList &append(Instruction *instruction);
 
+    /**
+     * Unlinks an instruction from the list; it must not be the end Stub
+     * and nothing should jump to it anymore.
+     */
+    void remove(Instruction *instruction);
+
+    /**
+     * Puts an instruction in place of another one, which keeps its address.
+     */
+    void replace(Instruction *instruction, Instruction *replacement);
+
+    /**
+     * Makes the list consist of given instructions, in given order, followed
+     * by the end Stub; instructions left out are unlinked. Every address is
+     * resolved anew on the next seal.
+     */
+    void relink(const std::vector<Instruction *> &sequence);
+
+    /**
+     * Writes every instruction of the list (skipping the Stubs); the list
+     * should be sealed first.
+     */
+    void emit(AssemblyWriter &writer);
+
     /**
      * "Seals" the list by giving each instruction on it a proper address,
      * excluding the Stubs which receive the address of the next instruction
      * on the list. Can be called multiple after modifying the list (e.g. by
-     * the PeepholeOptimizer) to reapply the addresses.
+     * the PeepholeOptimizer) to reapply the addresses; only instructions
+     * from the earliest modification on are visited again.
      * @param addHalt Decided if Halt instruction will be added to list's end.
      */
     void seal(bool addHalt);
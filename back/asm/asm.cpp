@@ -12,6 +12,10 @@ std::string Stub::toAssemblyCode(bool pretty) {
     return "ERROR - stub instructions should NEVER be compiled!";
 }
 
+void Stub::emit(AssemblyWriter &writer) {
+    // stubs are never written
+}
+
 long long Stub::getAddress() {
     return address;
 }
@@ -24,62 +28,126 @@ std::string Get::toAssemblyCode(bool pretty) {
     return "GET";
 }
 
+void Get::emit(AssemblyWriter &writer) {
+    writer.instruction("GET");
+}
+
 std::string Put::toAssemblyCode(bool pretty) {
     return "PUT";
 }
 
+void Put::emit(AssemblyWriter &writer) {
+    writer.instruction("PUT");
+}
+
 std::string Halt::toAssemblyCode(bool pretty) {
     return "HALT";
 }
 
+void Halt::emit(AssemblyWriter &writer) {
+    writer.instruction("HALT");
+}
+
 std::string Inc::toAssemblyCode(bool pretty) {
     return "INC";
 }
 
+void Inc::emit(AssemblyWriter &writer) {
+    writer.instruction("INC");
+}
+
 std::string Dec::toAssemblyCode(bool pretty) {
     return "DEC";
 }
 
+void Dec::emit(AssemblyWriter &writer) {
+    writer.instruction("DEC");
+}
+
 std::string Load::toAssemblyCode(bool pretty) {
     return "LOAD" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Load::emit(AssemblyWriter &writer) {
+    writer.instruction("LOAD", address.getAddress());
+}
+
 std::string Store::toAssemblyCode(bool pretty) {
     return "STORE" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Store::emit(AssemblyWriter &writer) {
+    writer.instruction("STORE", address.getAddress());
+}
+
 std::string Loadi::toAssemblyCode(bool pretty) {
     return "LOADI" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Loadi::emit(AssemblyWriter &writer) {
+    writer.instruction("LOADI", address.getAddress());
+}
+
 std::string Storei::toAssemblyCode(bool pretty) {
     return "STOREI" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Storei::emit(AssemblyWriter &writer) {
+    writer.instruction("STOREI", address.getAddress());
+}
+
 std::string Add::toAssemblyCode(bool pretty) {
     return "ADD" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Add::emit(AssemblyWriter &writer) {
+    writer.instruction("ADD", address.getAddress());
+}
+
 std::string Sub::toAssemblyCode(bool pretty) {
     return "SUB" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Sub::emit(AssemblyWriter &writer) {
+    writer.instruction("SUB", address.getAddress());
+}
+
 std::string Shift::toAssemblyCode(bool pretty) {
     return "SHIFT" + std::string(pretty ? " " : "") + std::to_string(address.getAddress());
 }
 
+void Shift::emit(AssemblyWriter &writer) {
+    writer.instruction("SHIFT", address.getAddress());
+}
+
 std::string Jump::toAssemblyCode(bool pretty) {
     return "JUMP" + std::string(pretty ? " " : "") + std::to_string(target->getAddress());
 }
 
+void Jump::emit(AssemblyWriter &writer) {
+    writer.instruction("JUMP", target->getAddress());
+}
+
 std::string Jpos::toAssemblyCode(bool pretty) {
     return "JPOS" + std::string(pretty ? " " : "") + std::to_string(target->getAddress());
 }
 
+void Jpos::emit(AssemblyWriter &writer) {
+    writer.instruction("JPOS", target->getAddress());
+}
+
 std::string Jzero::toAssemblyCode(bool pretty) {
     return "JZERO" + std::string(pretty ? " " : "") + std::to_string(target->getAddress());
 }
 
+void Jzero::emit(AssemblyWriter &writer) {
+    writer.instruction("JZERO", target->getAddress());
+}
+
 std::string Jneg::toAssemblyCode(bool pretty) {
     return "JNEG" + std::string(pretty ? " " : "") + std::to_string(target->getAddress());
+}
+
+void Jneg::emit(AssemblyWriter &writer) {
+    writer.instruction("JNEG", target->getAddress());
 }
\ No newline at end of file
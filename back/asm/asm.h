@@ -1,4 +1,6 @@
 #include "../../middle/abstract_assembler/Variables.h"
+#include "AssemblyWriter.h"
+#include "../../front/ast/Arena.h"
 #include <string>
 #include <vector>
 
@@ -15,18 +17,31 @@
  * STORE 1
  * LOAD has address of 0, ADD - 2 and STORE - 3.
  */
-class Instruction {
+class Instruction : public ArenaObject {
 protected:
     long long address = -1;
 public:
     bool stub = false;
 
+    /**
+     * Neighbours on the InstructionList this instruction belongs to,
+     * maintained by the list itself.
+     */
+    Instruction *previous = nullptr;
+    Instruction *next = nullptr;
+
     virtual void setAddress(long long newAddress);
 
     virtual long long getAddress();
 
     virtual std::string toAssemblyCode(bool pretty = false) = 0;
 
+    /**
+     * Writes the instruction (as a single line of assembly code) to
+     * the output; unlike toAssemblyCode it doesn't build any strings.
+     */
+    virtual void emit(AssemblyWriter &writer) = 0;
+
     virtual ~Instruction() {}
 };
 
@@ -51,6 +66,8 @@ class Stub : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     void setAddress(long long newAddress);
 
     long long getAddress();
@@ -63,26 +80,36 @@ public:
 class Get : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
+
+    virtual void emit(AssemblyWriter &writer);
 };
 
 class Put : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
+
+    virtual void emit(AssemblyWriter &writer);
 };
 
 class Halt : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
+
+    virtual void emit(AssemblyWriter &writer);
 };
 
 class Inc : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
+
+    virtual void emit(AssemblyWriter &writer);
 };
 
 class Dec : public Instruction {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
+
+    virtual void emit(AssemblyWriter &writer);
 };
 
 class InstructionUsingAddress : public Instruction {
@@ -99,6 +126,8 @@ class Load : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Load(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -106,6 +135,8 @@ class Store : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Store(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -113,6 +144,8 @@ class Loadi : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Loadi(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -120,6 +153,8 @@ class Storei : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Storei(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -127,6 +162,8 @@ class Add : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Add(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -134,6 +171,8 @@ class Sub : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Sub(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -141,6 +180,8 @@ class Shift : public InstructionUsingAddress {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
     Shift(ResolvableAddress &address) : InstructionUsingAddress(address) {}
 };
 
@@ -158,6 +199,13 @@ public:
 
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
+    /**
+     * @return True if the jump may fall through to the next instruction.
+     */
+    virtual bool conditional() { return false; }
+
     Jump(Instruction *target) : target(target) {}
 };
 
@@ -165,6 +213,10 @@ class Jpos : public Jump {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
+    bool conditional() { return true; }
+
     Jpos(Instruction *target) : Jump(target) {}
 };
 
@@ -172,6 +224,10 @@ class Jzero : public Jump {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
+    bool conditional() { return true; }
+
     Jzero(Instruction *target) : Jump(target) {}
 };
 
@@ -179,6 +235,10 @@ class Jneg : public Jump {
 public:
     virtual std::string toAssemblyCode(bool pretty = false);
 
+    virtual void emit(AssemblyWriter &writer);
+
+    bool conditional() { return true; }
+
     Jneg(Instruction *target) : Jump(target) {}
 };
 
@@ -0,0 +1,68 @@
+#include "Batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+BatchCompiler::BatchCompiler(const CompilerOptions &options, int jobs) : compiler(options), jobs(jobs) {
+    if (this->jobs <= 0) this->jobs = std::max(1u, std::thread::hardware_concurrency());
+}
+
+int BatchCompiler::compileDirectory(const std::string &directory) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    std::vector<std::filesystem::path> sources;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".imp") sources.push_back(entry.path());
+    }
+    if (error) {
+        std::cerr << "[e] Can't read directory " << directory << ": " << error.message() << std::endl;
+        return 1;
+    }
+    std::sort(sources.begin(), sources.end());
+
+    std::cout << "[i] Batch: " << sources.size() << " files on " << jobs << " threads" << std::endl;
+
+    std::atomic<size_t> nextSource(0);
+    std::atomic<int> compiled(0), warned(0), failed(0);
+    std::mutex outputLock;
+
+    auto worker = [&]() {
+        for (size_t i = nextSource++; i < sources.size(); i = nextSource++) {
+            std::filesystem::path output = sources[i];
+            output.replace_extension(".out");
+
+            std::ostringstream diagnostics;
+            CompilationResult result = compiler.compileFile(sources[i].string(), output.string(), diagnostics);
+
+            if (result == COMPILATION_FAILED) failed++;
+            else if (result == COMPILED_WITH_WARNINGS) warned++;
+            compiled += result != COMPILATION_FAILED;
+
+            std::lock_guard<std::mutex> guard(outputLock);
+            std::cout << diagnostics.str() << std::flush;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min<size_t>(jobs, sources.size()); i++) threads.emplace_back(worker);
+    worker(); // the main thread works too
+    for (auto &thread : threads) thread.join();
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    std::cout << (failed ? "[w]" : "[i]") << " Batch: " << compiled << " compiled (" << warned << " with warnings), "
+              << failed << " failed in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << std::endl;
+
+    if (compiler.getCache()) {
+        std::cout << "[i] Cache: " << compiler.getCache()->hits << " hits, " << compiler.getCache()->misses << " misses" << std::endl;
+    }
+
+    return failed;
+}
@@ -0,0 +1,33 @@
+#include <string>
+#include "Compiler.h"
+
+#ifndef COMPILER_BATCH_H
+#define COMPILER_BATCH_H
+
+/**
+ * Compiles every source file (*.imp) of a directory, each into an
+ * assembly file next to it with the .out extension, on a pool of
+ * threads. Diagnostics of a file are buffered and printed as a whole
+ * once it's done, so they never interleave with other files' ones.
+ */
+class BatchCompiler {
+private:
+    Compiler compiler;
+
+    int jobs;
+
+public:
+    /**
+     * @param directory Directory with the sources.
+     * @return Number of files that failed to compile.
+     */
+    int compileDirectory(const std::string &directory);
+
+    /**
+     * @param options Options of every compilation.
+     * @param jobs Number of threads; 0 picks one per hardware thread.
+     */
+    BatchCompiler(const CompilerOptions &options, int jobs);
+};
+
+#endif //COMPILER_BATCH_H
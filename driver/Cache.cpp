@@ -0,0 +1,149 @@
+#include "Cache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "Compiler.h"
+
+#ifndef BUILD_ID
+#define BUILD_ID __DATE__ " " __TIME__ // every build of the compiler gets its own entries
+#endif
+
+namespace fs = std::filesystem;
+
+/**
+ * 128-bit FNV-1a; wide enough that a collision (which would silently
+ * give a wrong program) isn't a practical concern.
+ */
+static unsigned __int128 fnv1a(unsigned __int128 hash, const std::string &data) {
+    const unsigned __int128 prime = ((unsigned __int128) 0x1000000ULL << 64) | 0x13BULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= prime;
+    }
+    return hash;
+}
+
+CompilationCache::CompilationCache(const std::string &directory, long long limit) : directory(directory), limit(limit) {
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error) throw "Can't create cache directory " + directory + ": " + error.message();
+}
+
+std::string CompilationCache::key(const std::string &tokens, const CompilerOptions &options) {
+    const unsigned __int128 offset = ((unsigned __int128) 0x6C62272E07BB0142ULL << 64) | 0x62B821756295C58DULL;
+
+    std::string settings = std::string(BUILD_ID) + "|o" + std::to_string(options.optimize) + "|v" + std::to_string(options.verbose)
+                           + "|u" + std::to_string(options.unrollBudget) + "|";
+    unsigned __int128 hash = fnv1a(fnv1a(offset, settings), tokens);
+
+    char hex[33];
+    snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long) (hash >> 64), (unsigned long long) hash);
+    return hex;
+}
+
+std::string CompilationCache::entryPath(const std::string &key) {
+    return directory + "/" + key + ".out";
+}
+
+bool CompilationCache::find(const std::string &key, std::string &assembly, std::string &warnings) {
+    std::string path = entryPath(key);
+
+    FILE *entry = fopen(path.c_str(), "rb");
+    if (!entry) {
+        misses++;
+        return false;
+    }
+
+    std::string content;
+    char buffer[1 << 16];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), entry)) > 0;) content.append(buffer, read);
+    bool failed = ferror(entry);
+    fclose(entry);
+
+    size_t code = 1, warningsLength = 0;
+    if (!failed && !content.empty() && content[0] == 'W') {
+        size_t newline = content.find('\n');
+        char *end = nullptr;
+        if (newline != std::string::npos) warningsLength = strtoull(content.c_str() + 1, &end, 10);
+        code = newline + 1 + warningsLength;
+        failed = newline == std::string::npos || end != content.c_str() + newline || code > content.size();
+    }
+
+    if (failed || content.empty() || (content[0] != 'S' && content[0] != 'W')) { // unreadable or not an entry at all
+        misses++;
+        return false;
+    }
+
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error); // the modification time orders the entries for eviction
+
+    warnings = content[0] == 'W' ? content.substr(code - warningsLength, warningsLength) : "";
+    assembly = content.substr(code);
+    hits++;
+    return true;
+}
+
+void CompilationCache::store(const std::string &key, const std::string &assembly, const std::string &warnings) {
+    std::string path = entryPath(key);
+    // unique among the threads of every process sharing the directory
+    std::string temporary = path + "." + std::to_string(getpid()) + "."
+                            + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+    FILE *entry = fopen(temporary.c_str(), "wb");
+    if (!entry) return; // the cache is only an optimization; failing to fill it isn't an error
+
+    std::string header = warnings.empty() ? "S" : "W" + std::to_string(warnings.size()) + "\n" + warnings;
+    bool failed = fwrite(header.data(), 1, header.size(), entry) != header.size()
+                  || fwrite(assembly.data(), 1, assembly.size(), entry) != assembly.size();
+    failed = fclose(entry) != 0 || failed;
+
+    std::error_code error;
+    if (!failed) fs::rename(temporary, path, error); // atomic, so readers never see a partial entry
+    if (failed || error) {
+        fs::remove(temporary, error);
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (size >= 0) size += header.size() + assembly.size();
+    if (size < 0 || size > limit) evict();
+}
+
+void CompilationCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        long long size;
+    };
+
+    std::vector<Entry> entries;
+    size = 0;
+
+    std::error_code error;
+    for (const auto &file : fs::directory_iterator(directory, error)) {
+        if (file.path().extension() != ".out") continue;
+
+        std::error_code fileError;
+        long long fileSize = file.file_size(fileError);
+        fs::file_time_type used = file.last_write_time(fileError);
+        if (fileError) continue; // removed by another process meanwhile
+
+        entries.push_back({file.path(), used, fileSize});
+        size += fileSize;
+    }
+
+    if (size <= limit) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.used < b.used;
+    });
+
+    for (const auto &entry : entries) {
+        if (size <= limit) break;
+        if (fs::remove(entry.path, error)) size -= entry.size;
+    }
+}
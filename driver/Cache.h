@@ -0,0 +1,77 @@
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#ifndef COMPILER_CACHE_H
+#define COMPILER_CACHE_H
+
+struct CompilerOptions;
+
+/**
+ * An on-disk cache of compiled programs, shared by every compilation
+ * (and every compiler process) using the same directory. Entries are
+ * addressed by a hash of the source's tokens (see Parser::tokens), the
+ * options affecting the output and the compiler's build, so reformatting
+ * or re-commenting a source still hits. When the entries outgrow the
+ * size limit, the least recently used ones are evicted.
+ * An entry is 'S' followed by the code, or 'W', the length of the
+ * warnings' text in decimal, a newline, the text and the code.
+ */
+class CompilationCache {
+private:
+    std::string directory;
+    long long limit;
+
+    std::mutex lock;
+
+    /**
+     * Size of the entries as of the last scan plus everything stored
+     * since; -1 before the first store.
+     */
+    long long size = -1;
+
+    std::string entryPath(const std::string &key);
+
+    /**
+     * Removes the least recently used entries until the cache fits its limit.
+     */
+    void evict();
+
+public:
+    static const long long DEFAULT_LIMIT = 64 * 1024 * 1024;
+
+    std::atomic<long long> hits{0};
+    std::atomic<long long> misses{0};
+
+    /**
+     * @param tokens Source's normalized tokens.
+     * @param options Options of the compilation.
+     * @return Key of the compilation's entry.
+     */
+    static std::string key(const std::string &tokens, const CompilerOptions &options);
+
+    /**
+     * Looks an entry up, marking it as recently used.
+     * @param key Entry's key.
+     * @param assembly Receives the cached code.
+     * @param warnings Receives the compilation's warnings, as they were
+     * printed; empty if there were none.
+     * @return True on a hit.
+     */
+    bool find(const std::string &key, std::string &assembly, std::string &warnings);
+
+    /**
+     * Adds an entry; it becomes visible to other processes at once, as
+     * a whole.
+     * @param warnings Compilation's warnings; empty if there were none.
+     */
+    void store(const std::string &key, const std::string &assembly, const std::string &warnings);
+
+    /**
+     * @param directory Cache's directory; created if it doesn't exist.
+     * @param limit Size limit of the entries in bytes.
+     */
+    CompilationCache(const std::string &directory, long long limit = DEFAULT_LIMIT);
+};
+
+#endif //COMPILER_CACHE_H
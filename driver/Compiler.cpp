@@ -0,0 +1,266 @@
+#include "Compiler.h"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "Diagnostics.h"
+#include "Stats.h"
+#include "../front/parser/Parser.h"
+#include "../middle/abstract_assembler/AbstractAssembler.h"
+#include "../middle/peephole/PeepholeOptimizer.h"
+
+/**
+ * @return Number of real (non-Stub) instructions on the list.
+ */
+static long long countInstructions(InstructionList &instructions) {
+    long long count = 0;
+    for (const auto &ins : instructions.getInstructions()) {
+        if (!ins->stub) count++;
+    }
+    return count;
+}
+
+static void printInstructions(InstructionList &instructions, std::ostream &out) {
+    for (const auto &ins : instructions.getInstructions()) {
+        if (!ins->stub) out << std::setbase(10) << ins->getAddress() << ": " << ins->toAssemblyCode(true) << std::endl;
+    }
+}
+
+Compiler::Compiler(const CompilerOptions &options) : options(options) {
+    if (options.cacheDirectory.empty()) return;
+
+    try {
+        cache = std::make_unique<CompilationCache>(options.cacheDirectory, options.cacheLimit);
+    } catch (std::string errorMessage) {
+        cacheError = errorMessage;
+    }
+}
+
+CompilationResult Compiler::compileFile(const std::string &sourcePath, const std::string &outputPath, std::ostream &out) {
+    if (!cacheError.empty()) out << "[w] " << cacheError << ", compiling without the cache" << std::endl;
+
+    SourceFile *source;
+    try {
+        source = new SourceFile(sourcePath);
+    } catch (std::string errorMessage) {
+        out << "[e] " << errorMessage << std::endl;
+        return COMPILATION_FAILED;
+    }
+
+    CompilationResult result;
+    if (cache) {
+        std::string assembly;
+        result = compileCached(sourcePath, source->text(), assembly, out);
+
+        if (result != COMPILATION_FAILED) {
+            try {
+                AssemblyWriter output(outputPath, options.mapOutput);
+                output.code(assembly);
+                output.close();
+            } catch (std::string errorMessage) {
+                out << "   [e] " << errorMessage << std::endl;
+                out << "[e] Aborting" << std::endl;
+                result = COMPILATION_FAILED;
+            }
+        }
+    } else {
+        result = run(sourcePath, [&]() {
+            return Parser::parse(*source);
+        }, [&](InstructionList &instructions) {
+            AssemblyWriter output(outputPath, options.mapOutput);
+            instructions.emit(output);
+            output.close();
+        }, out);
+    }
+
+    delete source;
+    return result;
+}
+
+CompilationOutput Compiler::compile(std::string_view source) {
+    CompilationOutput output;
+    std::ostringstream diagnostics;
+    if (!cacheError.empty()) diagnostics << "[w] " << cacheError << ", compiling without the cache" << std::endl;
+
+    if (cache) {
+        output.result = compileCached("<memory>", source, output.assembly, diagnostics);
+    } else {
+        output.result = run("<memory>", [&]() {
+            return Parser::parse(source);
+        }, [&](InstructionList &instructions) {
+            AssemblyWriter writer(&output.assembly);
+            instructions.emit(writer);
+            writer.close();
+        }, diagnostics);
+    }
+
+    if (output.result == COMPILATION_FAILED) output.assembly.clear();
+    output.diagnostics = diagnostics.str();
+    return output;
+}
+
+CompilationResult Compiler::compileCached(const std::string &name, std::string_view source, std::string &assembly, std::ostream &out) {
+    std::string key = CompilationCache::key(Parser::tokens(source), options);
+
+    std::string warnings;
+    if (cache->find(key, assembly, warnings)) {
+        out << "[i] Compiling file " << name << ": cache hit " << key << std::endl;
+        out << warnings;
+        out << (warnings.empty() ? "[i] Compiled successfully (cached)" : "[w] Compiled with warnings (cached)") << std::endl;
+        if (options.printStats || !options.tracePath.empty()) out << "[i] --stats and --trace skipped: the program came from the cache" << std::endl;
+        return warnings.empty() ? COMPILED : COMPILED_WITH_WARNINGS;
+    }
+
+    CompilationResult result = run(name, [&]() {
+        return Parser::parse(source);
+    }, [&](InstructionList &instructions) {
+        AssemblyWriter writer(&assembly);
+        instructions.emit(writer);
+        writer.close();
+    }, out, &warnings);
+
+    if (result == COMPILATION_FAILED) {
+        assembly.clear();
+    } else {
+        cache->store(key, assembly, warnings); // warnings about the compiler's own output files (e.g. the trace) aren't the program's
+    }
+    return result;
+}
+
+CompilationResult Compiler::run(const std::string &name, const std::function<Program *()> &parse,
+                                const std::function<void(InstructionList &)> &emit, std::ostream &out,
+                                std::string *warnings) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    Diagnostics diagnostics(out);
+    Diagnostics::setActive(&diagnostics);
+
+    Stats *stats = options.printStats || !options.tracePath.empty() ? new Stats() : nullptr; // phases and counters are only recorded when asked for
+    Stats::setActive(stats);
+
+    bool verbose = options.verbose, failed = false;
+    Program *program = nullptr;
+    Arena *previousArena = Arena::getActive();
+    Symbols *previousSymbols = Symbols::getActive();
+
+    out << "[i] Compiling file " << name << (options.optimize ? " with optimization" : " without optimization") << std::endl;
+
+    try {
+        out << "[i] Parsing... " << std::endl;
+        {
+            Phase phase("parse");
+            program = parse();
+        }
+        Arena::setActive(program->getArena()); // optimized nodes and assembled code go along with the AST
+        Symbols::setActive(program->getSymbols());
+        out << "   [i] done" << std::endl;
+
+        if (verbose) out << "-=- A S T -=-" << std::endl;
+        if (verbose) out << program->toString() << std::endl;
+
+        if (options.optimize) {
+            out << "[i] AST Optimization... " << std::endl;
+            if (verbose) out << std::endl;
+            ASTOptimizer astOptimizer(program, options.unrollBudget);
+            {
+                Phase phase("ast optimization");
+                astOptimizer.optimize(verbose);
+            }
+            if (verbose) out << std::endl;
+            out << "   [i] done" << std::endl;
+
+            if (verbose) out << "-=- OPTIMIZED A S T -=-" << std::endl;
+            if (verbose) out << program->toString() << std::endl;
+        }
+
+        AbstractAssembler assembler(*program);
+
+        out << "[i] Compiling... " << std::endl;
+        if (verbose) out << std::endl;
+
+        InstructionList &assembled = assembler.assemble(verbose); // in the program's arena, released along with it
+
+        out << "   [i] done" << std::endl;
+
+        if (verbose) out << std::endl << "-=- A S M -=-" << std::endl;
+
+        if (stats) Stats::set("instructions", countInstructions(assembled));
+
+        if (verbose) printInstructions(assembled, out);
+
+        if (options.optimize) {
+            out << "[i] ASM Optimization... " << std::endl;
+            if (verbose) out << std::endl;
+            PeepholeOptimizer peepholeOptimizer(assembled);
+
+            {
+                Phase phase("peephole");
+                peepholeOptimizer.optimize(verbose);
+                assembled.seal(false);
+            }
+            if (stats) Stats::set("instructions after peephole", countInstructions(assembled));
+
+            if (verbose) out << std::endl;
+            out << "   [i] done" << std::endl;
+
+            if (verbose) out << std::endl << "-=- OPTIMIZED A S M -=-" << std::endl;
+
+            if (verbose) printInstructions(assembled, out);
+        }
+
+        {
+            Phase phase("emit");
+            emit(assembled);
+        }
+
+        out << "[i] AST arena: " << program->getArena()->statistics() << std::endl;
+
+    } catch (std::string errorMessage) {
+        out << "   [e] " << errorMessage << std::endl;
+        out << "[e] Aborting" << std::endl;
+        failed = true;
+    } catch (char const *errorMessage) {
+        out << "   [e] " << errorMessage << std::endl;
+        out << "[e] Aborting" << std::endl;
+        failed = true;
+    }
+
+    Arena::setActive(previousArena);
+    Symbols::setActive(previousSymbols);
+    delete program;
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+
+    if (stats && !failed) {
+        Stats::set("peak rss (KiB)", Stats::peakResidentKiB());
+        if (!options.tracePath.empty()) {
+            try {
+                stats->writeTrace(options.tracePath);
+            } catch (std::string errorMessage) { // the program itself is fine, only its trace is missing
+                out << "   [w] " << errorMessage << std::endl;
+                diagnostics.warnings = true;
+            }
+        }
+    }
+
+    CompilationResult result = COMPILED;
+    if (failed) {
+        result = COMPILATION_FAILED;
+    } else if (diagnostics.warnings) {
+        out << "[w] Compiled with warnings in " << elapsed << " ms" << std::endl;
+        result = COMPILED_WITH_WARNINGS;
+    } else {
+        out << "[i] Compiled successfully in " << elapsed << " ms" << std::endl;
+    }
+
+    if (stats && !failed && options.printStats) out << "[i] Stats:" << std::endl << stats->summary();
+
+    Stats::setActive(nullptr);
+    delete stats;
+    Diagnostics::setActive(nullptr);
+    if (warnings) *warnings = diagnostics.warningLines;
+
+    return result;
+}
@@ -0,0 +1,125 @@
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "Cache.h"
+#include "../middle/ast_optimizer/ASTOptimizer.h"
+
+#ifndef COMPILER_COMPILER_H
+#define COMPILER_COMPILER_H
+
+/**
+ * Settings of a compilation, as given on the command line.
+ */
+struct CompilerOptions {
+    bool optimize = true;
+    bool verbose = false;
+    bool mapOutput = false;
+    bool printStats = false;
+    long long unrollBudget = ASTOptimizer::DEFAULT_UNROLL_BUDGET;
+
+    /**
+     * Chrome trace output file; empty if no trace should be written.
+     */
+    std::string tracePath;
+
+    /**
+     * Directory of the compilation cache; empty if there should be no cache.
+     */
+    std::string cacheDirectory;
+    long long cacheLimit = CompilationCache::DEFAULT_LIMIT;
+};
+
+enum CompilationResult {
+    COMPILATION_FAILED,
+    COMPILED_WITH_WARNINGS,
+    COMPILED
+};
+
+/**
+ * Outcome of an in-memory compilation.
+ */
+struct CompilationOutput {
+    CompilationResult result = COMPILATION_FAILED;
+
+    /**
+     * The finished program, one instruction per line; empty if the
+     * compilation failed.
+     */
+    std::string assembly;
+
+    /**
+     * Progress, warnings and errors, as they'd be printed by compileFile().
+     */
+    std::string diagnostics;
+};
+
+class Program;
+
+class InstructionList;
+
+/**
+ * The whole pipeline - parsing, AST optimization, assembling, peephole
+ * optimization and emitting - for a single source file. It keeps no
+ * global state, so one compiler may be used from many threads at once.
+ */
+class Compiler {
+private:
+    CompilerOptions options;
+
+    /**
+     * Shared by all compilations; nullptr when caching is off.
+     */
+    std::unique_ptr<CompilationCache> cache;
+
+    /**
+     * Why the cache couldn't be opened; reported by every compilation.
+     */
+    std::string cacheError;
+
+    /**
+     * Looks the source up in the cache and compiles it on a miss, filling
+     * the cache. A hit prints the warnings of the cached compilation again.
+     * @param assembly Receives the code.
+     */
+    CompilationResult compileCached(const std::string &name, std::string_view source, std::string &assembly, std::ostream &out);
+
+    /**
+     * Runs the pipeline.
+     * @param name Source's name for the messages.
+     * @param parse Produces the program's AST.
+     * @param emit Writes the finished code out.
+     * @param out Stream for the progress, warnings and errors.
+     * @param warnings If given, receives the program's warnings as they
+     * were printed (see Diagnostics::warningLines).
+     */
+    CompilationResult run(const std::string &name, const std::function<Program *()> &parse,
+                          const std::function<void(InstructionList &)> &emit, std::ostream &out,
+                          std::string *warnings = nullptr);
+
+public:
+    /**
+     * Compiles a source file into an assembly file.
+     * @param sourcePath Source file.
+     * @param outputPath Assembly file to be written.
+     * @param diagnostics Stream for the progress, warnings and errors.
+     * @return Whether the file compiled, and if so, whether with warnings.
+     */
+    CompilationResult compileFile(const std::string &sourcePath, const std::string &outputPath, std::ostream &diagnostics);
+
+    /**
+     * Compiles source text in memory, without touching any file (unless
+     * a trace is requested) or the standard output; meant for embedding
+     * the compiler in other programs.
+     * @param source Program's text.
+     * @return The assembly along with the diagnostics.
+     */
+    CompilationOutput compile(std::string_view source);
+
+    CompilationCache *getCache() { return cache.get(); }
+
+    Compiler(const CompilerOptions &options);
+};
+
+#endif //COMPILER_COMPILER_H
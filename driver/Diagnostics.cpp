@@ -0,0 +1,25 @@
+#include "Diagnostics.h"
+#include <iostream>
+
+thread_local Diagnostics *Diagnostics::active = nullptr;
+
+Diagnostics *Diagnostics::getActive() {
+    return active;
+}
+
+void Diagnostics::setActive(Diagnostics *diagnostics) {
+    active = diagnostics;
+}
+
+std::ostream &Diagnostics::out() {
+    return active ? active->stream : std::cout;
+}
+
+void Diagnostics::warn(const std::string &message) {
+    std::string line = "   [w] " + message + "\n";
+    out() << line << std::flush;
+
+    if (!active) return;
+    active->warnings = true;
+    active->warningLines += line;
+}
@@ -0,0 +1,43 @@
+#include <ostream>
+#include <string>
+
+#ifndef COMPILER_DIAGNOSTICS_H
+#define COMPILER_DIAGNOSTICS_H
+
+/**
+ * Messages of a single compilation. Every phase writes its progress
+ * and warnings to out(), which is the stream of the Diagnostics active
+ * on the current thread, so compilations running in parallel don't mix
+ * their output; with no active Diagnostics it's the standard output.
+ */
+class Diagnostics {
+private:
+    static thread_local Diagnostics *active;
+
+    std::ostream &stream;
+
+public:
+    bool warnings = false;
+
+    /**
+     * Every warning given by warn(), one per line, as it was printed.
+     */
+    std::string warningLines;
+
+    static Diagnostics *getActive();
+
+    static void setActive(Diagnostics *diagnostics);
+
+    static std::ostream &out();
+
+    /**
+     * Prints a warning to out() and marks the current compilation as one
+     * with warnings.
+     * @param message Warning's text, without the "[w]" mark.
+     */
+    static void warn(const std::string &message);
+
+    Diagnostics(std::ostream &stream) : stream(stream) {}
+};
+
+#endif //COMPILER_DIAGNOSTICS_H
@@ -0,0 +1,164 @@
+#include "Server.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Longest accepted source; anything longer is taken for a broken frame.
+ */
+static const unsigned int MAX_REQUEST_LENGTH = 64 * 1024 * 1024;
+
+/**
+ * @return False if the stream ended (or broke) before all bytes came.
+ */
+static bool readFully(int descriptor, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t result = read(descriptor, data, length);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        data += result;
+        length -= result;
+    }
+    return true;
+}
+
+static bool writeFully(int descriptor, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t result = write(descriptor, data, length);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        data += result;
+        length -= result;
+    }
+    return true;
+}
+
+static void encodeLength(unsigned int length, unsigned char *bytes) {
+    bytes[0] = length >> 24;
+    bytes[1] = length >> 16;
+    bytes[2] = length >> 8;
+    bytes[3] = length;
+}
+
+static unsigned int decodeLength(const unsigned char *bytes) {
+    return (unsigned int) bytes[0] << 24 | (unsigned int) bytes[1] << 16 | (unsigned int) bytes[2] << 8 | bytes[3];
+}
+
+CompileServer::CompileServer(const CompilerOptions &options, int jobs) : compiler(options), jobs(jobs) {
+    if (this->jobs <= 0) this->jobs = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void CompileServer::serve(int input, int output) {
+    std::string source;
+    unsigned char header[5];
+
+    while (readFully(input, reinterpret_cast<char *>(header), 4)) {
+        unsigned int length = decodeLength(header);
+        if (length > MAX_REQUEST_LENGTH) return;
+
+        source.resize(length);
+        if (!readFully(input, source.data(), length)) return;
+
+        CompilationOutput compiled = compiler.compile(source);
+
+        const std::string &body = compiled.result == COMPILATION_FAILED ? compiled.diagnostics : compiled.assembly;
+        header[0] = compiled.result == COMPILED ? 'S' : compiled.result == COMPILED_WITH_WARNINGS ? 'W' : 'E';
+        encodeLength(body.size(), header + 1);
+
+        if (!writeFully(output, reinterpret_cast<char *>(header), 5)) return;
+        if (!writeFully(output, body.data(), body.size())) return;
+    }
+}
+
+void CompileServer::listen(const std::string &path) {
+    signal(SIGPIPE, SIG_IGN); // a client going away must not kill the server
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw "Socket path too long: " + path;
+    strcpy(address.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) throw std::string("Can't create a socket: ") + strerror(errno);
+
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            close(listener);
+            throw path + " exists and isn't a socket";
+        }
+
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool served = probe >= 0 && connect(probe, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+        int probeError = errno;
+        if (probe >= 0) close(probe);
+        if (served || probeError != ECONNREFUSED) {
+            close(listener);
+            if (served) throw path + " is already being served";
+            throw "Can't check " + path + ": " + strerror(probeError);
+        }
+        unlink(path.c_str()); // nobody accepts on it: a stale socket of a server which is gone
+    }
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listener, SOMAXCONN) < 0) {
+        std::string error = "Can't listen on " + path + ": " + strerror(errno);
+        close(listener);
+        throw error;
+    }
+
+    std::cout << "[i] Serving on " << path << " with " << jobs << " threads" << std::endl;
+
+    std::mutex lock;
+    std::condition_variable accepted, taken;
+    std::deque<int> waiting; // accepted connections no thread has taken yet
+
+    auto worker = [&]() {
+        while (true) {
+            std::unique_lock<std::mutex> guard(lock);
+            accepted.wait(guard, [&]() { return !waiting.empty(); });
+            int connection = waiting.front();
+            waiting.pop_front();
+            guard.unlock();
+            taken.notify_one();
+
+            serve(connection, connection);
+            close(connection);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < jobs; i++) threads.emplace_back(worker);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock); // with every thread busy, further clients wait in the listen backlog
+            taken.wait(guard, [&]() { return waiting.size() < (size_t) jobs; });
+        }
+
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno != EINTR) std::cerr << "[w] accept failed: " << strerror(errno) << std::endl;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            waiting.push_back(connection);
+        }
+        accepted.notify_one();
+    }
+}
+
+void CompileServer::serveStandardStreams() {
+    serve(STDIN_FILENO, STDOUT_FILENO);
+}
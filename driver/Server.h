@@ -0,0 +1,57 @@
+#include <string>
+#include "Compiler.h"
+
+#ifndef COMPILER_SERVER_H
+#define COMPILER_SERVER_H
+
+/**
+ * Keeps a compiler resident and compiles programs sent to it, so the
+ * clients don't pay for starting a process per compilation.
+ *
+ * Every request is a frame: a 4-byte big-endian length followed by that
+ * many bytes of source text. Every response is a status byte ('S' for
+ * success, 'W' for success with warnings, 'E' for an error), a 4-byte
+ * big-endian length and the body: the assembly on success, or the
+ * diagnostics on an error. A connection may carry any number of requests;
+ * connections are served concurrently by a fixed pool of threads, one
+ * connection per thread at a time. Connections beyond that wait until
+ * a thread is free.
+ */
+class CompileServer {
+private:
+    Compiler compiler;
+
+    int jobs;
+
+    /**
+     * Answers requests read from one descriptor on another, until the
+     * input ends.
+     */
+    void serve(int input, int output);
+
+public:
+    /**
+     * Listens on a Unix domain socket (replacing a stale socket file,
+     * one which refuses connections) and never returns, unless it can't
+     * set the socket up.
+     * @param path Socket's path.
+     * @throws std::string when the socket can't be created, or when the
+     * path is taken by something else than a socket or by a socket some
+     * server still accepts connections on.
+     */
+    void listen(const std::string &path);
+
+    /**
+     * Answers requests framed on the standard input, on the standard output.
+     */
+    void serveStandardStreams();
+
+    /**
+     * @param options Options of every compilation.
+     * @param jobs Number of threads serving connections; 0 picks one per
+     * hardware thread.
+     */
+    CompileServer(const CompilerOptions &options, int jobs);
+};
+
+#endif //COMPILER_SERVER_H
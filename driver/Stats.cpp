@@ -0,0 +1,122 @@
+#include "Stats.h"
+#include <algorithm>
+#include <fstream>
+#include <sys/resource.h>
+
+namespace {
+    thread_local long long allocationCount = 0;
+    thread_local long long allocationBytes = 0;
+
+    std::string escape(const std::string &text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+thread_local Stats *Stats::active = nullptr;
+
+Stats *Stats::getActive() {
+    return active;
+}
+
+void Stats::setActive(Stats *stats) {
+    active = stats;
+}
+
+void Stats::count(const char *name, long long value) {
+    if (active) active->counters[name] += value;
+}
+
+void Stats::set(const char *name, long long value) {
+    if (active) active->counters[name] = value;
+}
+
+void Stats::allocated(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+}
+
+long long Stats::allocations() {
+    return allocationCount;
+}
+
+long long Stats::allocatedBytes() {
+    return allocationBytes;
+}
+
+long long Stats::peakResidentKiB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // KiB on Linux
+}
+
+long long Stats::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+std::string Stats::summary() {
+    std::vector<Event> ordered(events.begin(), events.end());
+    std::stable_sort(ordered.begin(), ordered.end(), [](const Event &a, const Event &b) {
+        return a.start < b.start || (a.start == b.start && a.depth < b.depth); // phases end (and are recorded) inner first
+    });
+
+    std::string s;
+    for (auto const &event : ordered) {
+        s += "   [i] " + std::string(event.depth * 2, ' ') + event.name + ": "
+             + std::to_string(event.duration / 1000) + "." + std::to_string(event.duration % 1000 / 100) + " ms, "
+             + std::to_string(event.allocations) + " allocations (" + std::to_string(event.allocatedBytes / 1024) + " KiB)\n";
+    }
+    for (auto const &counter : counters) {
+        s += "   [i] " + counter.first + ": " + std::to_string(counter.second) + "\n";
+    }
+    return s;
+}
+
+void Stats::writeTrace(const std::string &path) {
+    std::ofstream trace(path);
+    if (!trace) throw "Can't write trace to " + path;
+
+    trace << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto const &event : events) {
+        trace << (first ? "" : ",") << "\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"compiler\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+              << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+              << ",\"args\":{\"allocations\":" << event.allocations << ",\"allocatedBytes\":" << event.allocatedBytes << "}}";
+        first = false;
+    }
+
+    long long end = now();
+    for (auto const &counter : counters) {
+        trace << (first ? "" : ",") << "\n{\"name\":\"" << escape(counter.first) << "\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":" << end
+              << ",\"args\":{\"value\":" << counter.second << "}}";
+        first = false;
+    }
+    trace << "\n]}\n";
+}
+
+Phase::Phase(const char *name) : stats(Stats::getActive()), name(name) {
+    if (!stats) return;
+
+    start = stats->now();
+    allocations = Stats::allocations();
+    allocatedBytes = Stats::allocatedBytes();
+    stats->depth++;
+}
+
+Phase::~Phase() {
+    if (!stats) return;
+
+    stats->depth--;
+    stats->events.push_back(Stats::Event{
+            name,
+            stats->depth,
+            start,
+            stats->now() - start,
+            Stats::allocations() - allocations,
+            Stats::allocatedBytes() - allocatedBytes
+    });
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifndef COMPILER_STATS_H
+#define COMPILER_STATS_H
+
+/**
+ * Statistics of a single compilation: wall time and heap allocations of
+ * its phases (see Phase) and named counters. Collecting is enabled by
+ * making a Stats object active; with no active Stats every phase and
+ * counter costs a single thread-local check.
+ */
+class Stats {
+private:
+    static thread_local Stats *active;
+
+    std::chrono::steady_clock::time_point started;
+
+    int depth = 0;
+
+public:
+    /**
+     * A finished phase; times are in microseconds since the Stats was created.
+     */
+    struct Event {
+        std::string name;
+        int depth;
+        long long start;
+        long long duration;
+        long long allocations;
+        long long allocatedBytes;
+    };
+
+    std::vector<Event> events;
+    std::map<std::string, long long> counters;
+
+    static Stats *getActive();
+
+    static void setActive(Stats *stats);
+
+    /**
+     * Adds to a counter of the active Stats, if there is one.
+     */
+    static void count(const char *name, long long value = 1);
+
+    /**
+     * Sets a counter of the active Stats, if there is one.
+     */
+    static void set(const char *name, long long value);
+
+    /**
+     * Counts a heap allocation of this thread. It's called by the global
+     * operator new of the kompilator executable (see allocations.cpp);
+     * the library leaves the allocation functions of its host alone, so
+     * embedded compilations report no allocations.
+     */
+    static void allocated(size_t size);
+
+    /**
+     * @return Number of heap allocations (operator new) made by this thread so far.
+     */
+    static long long allocations();
+
+    static long long allocatedBytes();
+
+    /**
+     * @return Peak resident set size of the process in KiB.
+     */
+    static long long peakResidentKiB();
+
+    long long now();
+
+    /**
+     * @return Human readable phases and counters, one per line, for
+     * the compiler's summary.
+     */
+    std::string summary();
+
+    /**
+     * Writes phases and counters in the Chrome trace event format
+     * (loadable in chrome://tracing or Perfetto).
+     * @param path Output file.
+     * @throws std::string when the file can't be written.
+     */
+    void writeTrace(const std::string &path);
+
+    Stats() : started(std::chrono::steady_clock::now()) {}
+
+    friend class Phase;
+};
+
+/**
+ * Records its own lifetime as a phase of the active Stats, e.g.
+ * { Phase phase("parse"); yyparse(); }
+ */
+class Phase {
+private:
+    Stats *stats;
+    const char *name;
+    long long start;
+    long long allocations;
+    long long allocatedBytes;
+
+public:
+    Phase(const char *name);
+
+    Phase(const Phase &) = delete;
+
+    Phase &operator=(const Phase &) = delete;
+
+    ~Phase();
+};
+
+#endif //COMPILER_STATS_H
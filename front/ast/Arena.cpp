@@ -0,0 +1,56 @@
+#include "Arena.h"
+
+thread_local Arena *Arena::active = nullptr;
+
+Arena *Arena::getActive() {
+    return active;
+}
+
+void Arena::setActive(Arena *arena) {
+    active = arena;
+}
+
+char *Arena::newBlock(size_t size) {
+    char *block = static_cast<char *>(::operator new(size));
+    blocks.push_back(block);
+    reservedBytes += size;
+    return block;
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+    allocations++;
+    usedBytes += size;
+
+    size_t padding = cursor ? (alignment - reinterpret_cast<size_t>(cursor) % alignment) % alignment : 0;
+    if (cursor && padding + size <= remaining) {
+        char *result = cursor + padding;
+        cursor += padding + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    if (size > BLOCK_SIZE / 4) { // big chunks (e.g. long node lists) get their own block, leaving the current one be
+        return newBlock(size);
+    }
+
+    cursor = newBlock(BLOCK_SIZE); // operator new returns memory aligned for any fundamental type
+    remaining = BLOCK_SIZE - size;
+    char *result = cursor;
+    cursor += size;
+    return result;
+}
+
+std::string Arena::statistics() {
+    return std::to_string(allocations) + " allocations, "
+           + std::to_string(usedBytes / 1024) + " KiB used in "
+           + std::to_string(blocks.size()) + " blocks ("
+           + std::to_string(reservedBytes / 1024) + " KiB reserved)";
+}
+
+Arena::~Arena() {
+    if (active == this) active = nullptr;
+
+    for (const auto &block : blocks) {
+        ::operator delete(block);
+    }
+}
@@ -0,0 +1,123 @@
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef COMPILER_ARENA_H
+#define COMPILER_ARENA_H
+
+/**
+ * A bump allocator holding the whole AST of a single compilation.
+ * Nodes are never freed one by one; instead the whole arena (with
+ * every node and node list placed in it) is released at once when
+ * its owner (the Program) is destroyed.
+ * An arena has to be made active before parsing, so that every
+ * `new SomeNode(...)` - in bison actions as well as in the optimizer
+ * copies - lands in it.
+ */
+class Arena {
+private:
+    static thread_local Arena *active;
+
+    std::vector<char *> blocks;
+
+    char *cursor = nullptr;
+    size_t remaining = 0;
+
+    long long allocations = 0;
+    long long usedBytes = 0;
+    long long reservedBytes = 0;
+
+    char *newBlock(size_t size);
+
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @return The arena new nodes are placed in on this thread, or
+     * nullptr if there is none.
+     */
+    static Arena *getActive();
+
+    static void setActive(Arena *arena);
+
+    /**
+     * Bumps the arena by a properly aligned chunk of memory.
+     * @param size Size of the chunk in bytes.
+     * @param alignment Required alignment of the chunk.
+     * @return Pointer to the uninitialized memory.
+     */
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * @return Human readable allocation statistics, e.g. for the
+     * compiler's summary.
+     */
+    std::string statistics();
+
+    long long getAllocations() const { return allocations; }
+
+    long long getUsedBytes() const { return usedBytes; }
+
+    long long getReservedBytes() const { return reservedBytes; }
+
+    Arena() {}
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    ~Arena();
+};
+
+/**
+ * A std allocator placing containers' storage in the arena active
+ * at the time of their construction; used for AST node lists. When
+ * no arena is active it falls back to the ordinary heap.
+ */
+template<class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    Arena *arena;
+
+    ArenaAllocator() : arena(Arena::getActive()) {}
+
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        if (arena) return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, size_t) {
+        if (!arena) ::operator delete(pointer); // arena memory is released all at once
+    }
+
+    template<class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+    template<class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+/**
+ * A base of the back end's small objects - instructions and their lists,
+ * addresses, resolutions, variables - which, just like AST nodes, are
+ * placed in the active Arena and released together with the Program
+ * owning it. They're never destroyed one by one, so they must not own
+ * anything outside of the arena.
+ */
+class ArenaObject {
+public:
+    static void *operator new(size_t size) {
+        Arena *arena = Arena::getActive();
+        if (arena) return arena->allocate(size, alignof(std::max_align_t));
+        return ::operator new(size); // no arena, e.g. code assembled outside of a compilation
+    }
+
+    static void operator delete(void *) {}
+};
+
+#endif //COMPILER_ARENA_H
@@ -0,0 +1,63 @@
+#include "Symbols.h"
+#include <mutex>
+
+thread_local Symbols *Symbols::active = nullptr;
+
+namespace {
+    /**
+     * The table used outside of compilations; unlike the programs' ones,
+     * it may be shared by threads.
+     */
+    struct SharedSymbols {
+        std::mutex lock;
+        Symbols symbols;
+    };
+
+    SharedSymbols &shared() {
+        static SharedSymbols sharedSymbols; // constructed on first use, before any static intern() calls need it
+        return sharedSymbols;
+    }
+}
+
+Symbols *Symbols::getActive() {
+    return active;
+}
+
+void Symbols::setActive(Symbols *symbols) {
+    active = symbols;
+}
+
+Symbol Symbols::find(const char *text, size_t length) {
+    auto found = ids.find(std::string_view(text, length));
+    if (found != ids.end()) return found->second;
+
+    names.emplace_back(text, length);
+    Symbol symbol = names.size() - 1;
+    ids.emplace(std::string_view(names.back()), symbol);
+    return symbol;
+}
+
+Symbol Symbols::intern(const char *text, size_t length) {
+    if (active) return active->find(text, length);
+
+    std::lock_guard<std::mutex> guard(shared().lock);
+    return shared().symbols.find(text, length);
+}
+
+const std::string &Symbols::name(Symbol symbol) {
+    if (active) return active->names[symbol];
+
+    std::lock_guard<std::mutex> guard(shared().lock);
+    return shared().symbols.names[symbol];
+}
+
+Symbol Symbols::count() {
+    if (active) return active->names.size();
+
+    std::lock_guard<std::mutex> guard(shared().lock);
+    return shared().symbols.names.size();
+}
+
+Symbols::~Symbols() {
+    if (active == this) active = nullptr;
+}
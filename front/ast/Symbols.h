@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#ifndef COMPILER_SYMBOLS_H
+#define COMPILER_SYMBOLS_H
+
+/**
+ * A dense id of an interned identifier; two identifiers are the same
+ * name exactly when their symbols are equal.
+ */
+typedef unsigned int Symbol;
+
+/**
+ * An identifier interner. The lexer turns every identifier into a
+ * Symbol right away, so the rest of the pipeline (symbol tables,
+ * optimizer replacers) compares integers instead of strings; the text
+ * is only needed again for messages and AST dumps.
+ * Every Program has a table of its own, so its symbols count from 0
+ * and symbol-indexed tables are only as big as the program is. Just
+ * like an Arena, a table has to be made active on the thread using
+ * it; with no active table, a process-wide one (guarded by a lock) is
+ * used.
+ */
+class Symbols {
+private:
+    static thread_local Symbols *active;
+
+    /**
+     * Interned texts; a deque never moves its elements, so the views
+     * used as index keys stay valid.
+     */
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, Symbol> ids;
+
+    Symbol find(const char *text, size_t length);
+
+public:
+    /**
+     * @return The table of this thread's compilation, or nullptr if there
+     * is none.
+     */
+    static Symbols *getActive();
+
+    static void setActive(Symbols *symbols);
+
+    /**
+     * Finds or creates a symbol for given text.
+     * @param text Identifier's characters (not necessarily null-terminated).
+     * @param length Number of characters.
+     * @return A symbol unique for that text.
+     */
+    static Symbol intern(const char *text, size_t length);
+
+    static Symbol intern(const std::string &text) {
+        return intern(text.data(), text.size());
+    }
+
+    /**
+     * @return Text of an interned symbol.
+     */
+    static const std::string &name(Symbol symbol);
+
+    /**
+     * @return Number of symbols interned so far; all symbols are lower
+     * than it, so it may be used to size symbol-indexed tables.
+     */
+    static Symbol count();
+
+    Symbols() {}
+
+    Symbols(const Symbols &) = delete;
+
+    Symbols &operator=(const Symbols &) = delete;
+
+    ~Symbols();
+};
+
+#endif //COMPILER_SYMBOLS_H
@@ -1,6 +1,15 @@
 #include "node.h"
+#include "../../driver/Stats.h"
 #include <string>
 
+void *Node::operator new(size_t size) {
+    Stats::count("ast nodes");
+
+    Arena *arena = Arena::getActive();
+    if (arena) return arena->allocate(size, alignof(std::max_align_t));
+    return ::operator new(size); // no arena, e.g. a node built outside of a compilation
+}
+
 /* ==== toString ==== */
 
 std::string Node::indent(int indentation) {
@@ -8,15 +17,15 @@ std::string Node::indent(int indentation) {
 }
 
 std::string VariableIdentifier::toString(int indentation) {
-    return indent(indentation) + "Variable<" + name + ">\n";
+    return indent(indentation) + "Variable<" + Symbols::name(name) + ">\n";
 }
 
 std::string AccessIdentifier::toString(int indentation) {
-    return indent(indentation) + "ArrayAccess<" + name + ">[" + std::to_string(index) + "]\n";
+    return indent(indentation) + "ArrayAccess<" + Symbols::name(name) + ">[" + std::to_string(index) + "]\n";
 }
 
 std::string VariableAccessIdentifier::toString(int indentation) {
-    return indent(indentation) + "ArrayAccess<" + name + ">[" + accessName + "]\n";
+    return indent(indentation) + "ArrayAccess<" + Symbols::name(name) + ">[" + Symbols::name(accessName) + "]\n";
 }
 
 std::string NumberValue::toString(int indentation) {
@@ -73,7 +82,7 @@ std::string While::toString(int indentation) {
 }
 
 std::string For::toString(int indentation) {
-    return indent(indentation) + "For<" + variableName + ",\n" + startValue.toString(indentation + 1) +
+    return indent(indentation) + "For<" + Symbols::name(variableName) + (unroll > 1 ? " x" + std::to_string(unroll) : "") + ",\n" + startValue.toString(indentation + 1) +
            endValue.toString(indentation + 1) + commands.toString(indentation + 1) + indent(indentation) + ">\n";
 }
 
@@ -93,11 +102,11 @@ std::string DeclarationList::toString(int indentation) {
 }
 
 std::string IdentifierDeclaration::toString(int indentation) {
-    return indent(indentation) + "IdentifierDeclaration<" + name + ">\n";
+    return indent(indentation) + "IdentifierDeclaration<" + Symbols::name(name) + ">\n";
 }
 
 std::string ArrayDeclaration::toString(int indentation) {
-    return indent(indentation) + "ArrayDeclaration<" + name + "," + std::to_string(start) + "," + std::to_string(end) +
+    return indent(indentation) + "ArrayDeclaration<" + Symbols::name(name) + "," + std::to_string(start) + "," + std::to_string(end) +
            ">\n";
 }
 
@@ -5,6 +5,9 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <unordered_set>
+#include "Arena.h"
+#include "Symbols.h"
 
 #ifndef COMPILER_NODE_H
 #define COMPILER_NODE_H
@@ -30,11 +33,51 @@ enum ConditionType {
     GREATER_OR_EQUAL
 };
 
+/**
+ * Concrete type of an AST node; every node class has its own kind.
+ */
+enum NodeKind {
+    VARIABLE_IDENTIFIER_NODE,
+    ACCESS_IDENTIFIER_NODE,
+    VARIABLE_ACCESS_IDENTIFIER_NODE,
+    NUMBER_VALUE_NODE,
+    IDENTIFIER_VALUE_NODE,
+    UNARY_EXPRESSION_NODE,
+    BINARY_EXPRESSION_NODE,
+    CONDITION_NODE,
+    COMMAND_LIST_NODE,
+    ASSIGNMENT_NODE,
+    IF_NODE,
+    IF_ELSE_NODE,
+    WHILE_NODE,
+    FOR_NODE,
+    READ_NODE,
+    WRITE_NODE,
+    IDENTIFIER_DECLARATION_NODE,
+    ARRAY_DECLARATION_NODE,
+    DECLARATION_LIST_NODE
+};
+
 /**
  * Base abstract class for representing anything in AST.
  */
 class Node {
 public:
+    /**
+     * Passes switch over the kind (or use as<T>()) instead of probing
+     * nodes with dynamic_cast, so a node of some other type costs a
+     * single comparison.
+     */
+    const NodeKind kind;
+
+    /**
+     * @return This node as a T if it is one; nullptr otherwise.
+     */
+    template<class T>
+    T *as() {
+        return kind == T::KIND ? static_cast<T *>(this) : nullptr;
+    }
+
     std::string indent(int indentation);
 
     virtual std::string toString(int indentation) = 0;
@@ -45,12 +88,21 @@ public:
      * @param replacer A function to be used on a copy. This function will return
      * a normal copy or an augmented copy of this node. E.g. if we needed to replace
      * every IdentifierValue in this node (and its children) with a NumberValue
-     * we would just write a Callback function dynamic casting to check if a node
+     * we would just write a Callback function checking node's kind to see if it
      * is a IdentifierValue and then returning a NumberValue.
      * @return An exact copy of this node with respect to replacer function.
      */
     virtual Node *copy(Callback replacer) = 0;
 
+    /**
+     * Nodes are placed in the active Arena and released together with it.
+     */
+    static void *operator new(size_t size);
+
+    static void operator delete(void *) {}
+
+    Node(NodeKind kind) : kind(kind) {}
+
     virtual ~Node() {}
 };
 
@@ -59,9 +111,9 @@ public:
  */
 class AbstractIdentifier : public Node {
 public:
-    std::string &name;
+    Symbol name;
 
-    AbstractIdentifier(std::string &name) : name(name) {}
+    AbstractIdentifier(NodeKind kind, Symbol name) : Node(kind), name(name) {}
 
     virtual Node *copy(Callback replacer) = 0;
 
@@ -73,13 +125,15 @@ public:
  */
 class VariableIdentifier : public AbstractIdentifier {
 public:
+    static const NodeKind KIND = VARIABLE_IDENTIFIER_NODE;
+
     virtual std::string toString(int indentation);
 
     virtual Node *copy(Callback replacer) {
         return replacer(new VariableIdentifier(name));
     }
 
-    VariableIdentifier(std::string &name) : AbstractIdentifier(name) {}
+    VariableIdentifier(Symbol name) : AbstractIdentifier(KIND, name) {}
 };
 
 /**
@@ -87,6 +141,8 @@ public:
  */
 class AccessIdentifier : public AbstractIdentifier {
 public:
+    static const NodeKind KIND = ACCESS_IDENTIFIER_NODE;
+
     long long index;
 
     virtual std::string toString(int indentation);
@@ -95,7 +151,7 @@ public:
         return replacer(new AccessIdentifier(name, index));
     }
 
-    AccessIdentifier(std::string &name, long long index) : AbstractIdentifier(name), index(index) {}
+    AccessIdentifier(Symbol name, long long index) : AbstractIdentifier(KIND, name), index(index) {}
 };
 
 /**
@@ -103,7 +159,9 @@ public:
  */
 class VariableAccessIdentifier : public AbstractIdentifier {
 public:
-    std::string &accessName;
+    static const NodeKind KIND = VARIABLE_ACCESS_IDENTIFIER_NODE;
+
+    Symbol accessName;
 
     virtual std::string toString(int indentation);
 
@@ -111,8 +169,8 @@ public:
         return replacer(new VariableAccessIdentifier(name, accessName));
     }
 
-    VariableAccessIdentifier(std::string &name, std::string &accessName)
-            : AbstractIdentifier(name), accessName(accessName) {}
+    VariableAccessIdentifier(Symbol name, Symbol accessName)
+            : AbstractIdentifier(KIND, name), accessName(accessName) {}
 };
 
 /**
@@ -120,6 +178,8 @@ public:
  */
 class AbstractValue : public Node {
 public:
+    AbstractValue(NodeKind kind) : Node(kind) {}
+
     virtual ~AbstractValue() {}
 
     virtual Node *copy(Callback replacer) = 0;
@@ -130,6 +190,8 @@ public:
  */
 class NumberValue : public AbstractValue {
 public:
+    static const NodeKind KIND = NUMBER_VALUE_NODE;
+
     long long value;
 
     virtual std::string toString(int indentation);
@@ -138,7 +200,7 @@ public:
         return replacer(new NumberValue(value));
     }
 
-    NumberValue(long long value) : value(value) {}
+    NumberValue(long long value) : AbstractValue(KIND), value(value) {}
 };
 
 /**
@@ -146,6 +208,8 @@ public:
  */
 class IdentifierValue : public AbstractValue {
 public:
+    static const NodeKind KIND = IDENTIFIER_VALUE_NODE;
+
     AbstractIdentifier &identifier;
 
     virtual std::string toString(int indentation);
@@ -154,7 +218,7 @@ public:
         return replacer(new IdentifierValue(*static_cast<AbstractIdentifier *>(identifier.copy(replacer))));
     }
 
-    IdentifierValue(AbstractIdentifier &identifier) : identifier(identifier) {}
+    IdentifierValue(AbstractIdentifier &identifier) : AbstractValue(KIND), identifier(identifier) {}
 };
 
 /**
@@ -162,6 +226,8 @@ public:
  */
 class AbstractExpression : public Node {
 public:
+    AbstractExpression(NodeKind kind) : Node(kind) {}
+
     virtual ~AbstractExpression() {}
 
     virtual Node *copy(Callback replacer) = 0;
@@ -172,6 +238,8 @@ public:
  */
 class UnaryExpression : public AbstractExpression {
 public:
+    static const NodeKind KIND = UNARY_EXPRESSION_NODE;
+
     AbstractValue &value;
 
     virtual std::string toString(int indentation);
@@ -180,7 +248,7 @@ public:
         return replacer(new UnaryExpression(*static_cast<AbstractValue *>(value.copy(replacer))));
     }
 
-    UnaryExpression(AbstractValue &value) : value(value) {}
+    UnaryExpression(AbstractValue &value) : AbstractExpression(KIND), value(value) {}
 };
 
 /**
@@ -189,18 +257,29 @@ public:
  */
 class BinaryExpression : public AbstractExpression {
 public:
+    static const NodeKind KIND = BINARY_EXPRESSION_NODE;
+
     AbstractValue &lhs;
     AbstractValue &rhs;
     BinaryExpressionType type;
 
+    /**
+     * A variable a DIVISION or MODULO also assigns the other one of the
+     * quotient and the remainder to, as the same division yields both;
+     * nullptr if none.
+     */
+    AbstractIdentifier *companion = nullptr;
+
     virtual std::string toString(int indentation);
 
     virtual Node *copy(Callback replacer) {
-        return replacer(new BinaryExpression(*static_cast<AbstractValue *>(lhs.copy(replacer)), *static_cast<AbstractValue *>(rhs.copy(replacer)), type));
+        auto expression = new BinaryExpression(*static_cast<AbstractValue *>(lhs.copy(replacer)), *static_cast<AbstractValue *>(rhs.copy(replacer)), type);
+        if (companion) expression->companion = static_cast<AbstractIdentifier *>(companion->copy(replacer));
+        return replacer(expression);
     }
 
     BinaryExpression(AbstractValue &lhs, AbstractValue &rhs, BinaryExpressionType type)
-            : lhs(lhs), rhs(rhs), type(type) {}
+            : AbstractExpression(KIND), lhs(lhs), rhs(rhs), type(type) {}
 };
 
 /**
@@ -209,6 +288,8 @@ public:
  */
 class Condition : public Node {
 public:
+    static const NodeKind KIND = CONDITION_NODE;
+
     AbstractValue &lhs;
     AbstractValue &rhs;
     ConditionType type;
@@ -220,7 +301,7 @@ public:
     }
 
     Condition(AbstractValue &lhs, AbstractValue &rhs, ConditionType type)
-            : lhs(lhs), rhs(rhs), type(type) {}
+            : Node(KIND), lhs(lhs), rhs(rhs), type(type) {}
 };
 
 /**
@@ -228,6 +309,8 @@ public:
  */
 class Command : public Node {
 public:
+    Command(NodeKind kind) : Node(kind) {}
+
     virtual ~Command() {}
 
     virtual Node *copy(Callback replacer) = 0;
@@ -238,7 +321,9 @@ public:
  */
 class CommandList : public Node {
 public:
-    std::vector<Node *> commands;
+    static const NodeKind KIND = COMMAND_LIST_NODE;
+
+    std::vector<Node *, ArenaAllocator<Node *>> commands;
 
     virtual std::string toString(int indentation);
 
@@ -255,7 +340,7 @@ public:
         commands.insert(commands.end(), commandList.commands.begin(), commandList.commands.end());
     }
 
-    CommandList() {}
+    CommandList() : Node(KIND) {}
 };
 
 /**
@@ -263,6 +348,8 @@ public:
  */
 class Assignment : public Command {
 public:
+    static const NodeKind KIND = ASSIGNMENT_NODE;
+
     AbstractIdentifier &identifier;
     AbstractExpression &expression;
 
@@ -273,7 +360,7 @@ public:
     }
 
     Assignment(AbstractIdentifier &identifier, AbstractExpression &expression)
-            : identifier(identifier), expression(expression) {}
+            : Command(KIND), identifier(identifier), expression(expression) {}
 };
 
 /**
@@ -281,6 +368,8 @@ public:
  */
 class If : public Command {
 public:
+    static const NodeKind KIND = IF_NODE;
+
     Condition &condition;
     CommandList &commands;
 
@@ -290,7 +379,7 @@ public:
         return replacer(new If(*static_cast<Condition *>(condition.copy(replacer)), *static_cast<CommandList * >(commands.copy(replacer))));
     }
 
-    If(Condition &condition, CommandList &commands) : condition(condition), commands(commands) {}
+    If(Condition &condition, CommandList &commands) : Command(KIND), condition(condition), commands(commands) {}
 };
 
 /**
@@ -298,6 +387,8 @@ public:
  */
 class IfElse : public Command {
 public:
+    static const NodeKind KIND = IF_ELSE_NODE;
+
     Condition &condition;
     CommandList &commands;
     CommandList &elseCommands;
@@ -310,7 +401,7 @@ public:
     }
 
     IfElse(Condition &condition, CommandList &commands, CommandList &elseCommands)
-            : condition(condition), commands(commands), elseCommands(elseCommands) {}
+            : Command(KIND), condition(condition), commands(commands), elseCommands(elseCommands) {}
 };
 
 /**
@@ -318,6 +409,8 @@ public:
  */
 class While : public Command {
 public:
+    static const NodeKind KIND = WHILE_NODE;
+
     Condition &condition;
     CommandList &commands;
     bool doWhile;
@@ -329,34 +422,40 @@ public:
     }
 
     While(Condition &condition, CommandList &commands, bool doWhile = false)
-            : condition(condition), commands(commands), doWhile(doWhile) {}
+            : Command(KIND), condition(condition), commands(commands), doWhile(doWhile) {}
 };
 
 /**
  * Executes commands fixed amount of times and creates a local
  * variable (called iterator) which increments or decrements
  * with each iteration.
+ * A loop may be partially unrolled; its commands are then repeated
+ * `unroll` times between two checks of the iterator, so the number of
+ * iterations has to be a multiple of it.
  */
 class For : public Command {
 public:
-    std::string variableName;
+    static const NodeKind KIND = FOR_NODE;
+
+    Symbol variableName;
     AbstractValue &startValue;
     AbstractValue &endValue;
     CommandList &commands;
     bool reversed;
+    long long unroll;
 
     virtual std::string toString(int indentation);
 
     virtual Node *copy(Callback replacer) {
         return replacer(new For(variableName, *static_cast<AbstractValue *>(startValue.copy(replacer)), *static_cast<AbstractValue *>(endValue.copy(replacer)),
-                                *static_cast<CommandList *>(commands.copy(replacer)), reversed));
+                                *static_cast<CommandList *>(commands.copy(replacer)), reversed, unroll));
     }
 
-    For(std::string &variableName, AbstractValue &startValue, AbstractValue &endValue,
+    For(Symbol variableName, AbstractValue &startValue, AbstractValue &endValue,
         CommandList &commands,
-        bool reversed = false)
-            : variableName(variableName), startValue(startValue), endValue(endValue), commands(commands),
-              reversed(reversed) {}
+        bool reversed = false, long long unroll = 1)
+            : Command(KIND), variableName(variableName), startValue(startValue), endValue(endValue), commands(commands),
+              reversed(reversed), unroll(unroll) {}
 };
 
 /**
@@ -364,6 +463,8 @@ public:
  */
 class Read : public Command {
 public:
+    static const NodeKind KIND = READ_NODE;
+
     AbstractIdentifier &identifier;
 
     virtual std::string toString(int indentation);
@@ -372,7 +473,7 @@ public:
         return replacer(new Read(*static_cast<AbstractIdentifier *>(identifier.copy(replacer))));
     }
 
-    Read(AbstractIdentifier &identifier) : identifier(identifier) {}
+    Read(AbstractIdentifier &identifier) : Command(KIND), identifier(identifier) {}
 };
 
 /**
@@ -380,6 +481,8 @@ public:
  */
 class Write : public Command {
 public:
+    static const NodeKind KIND = WRITE_NODE;
+
     AbstractValue &value;
 
     virtual std::string toString(int indentation);
@@ -388,7 +491,7 @@ public:
         return replacer(new Write(*static_cast<AbstractValue *>(value.copy(replacer))));
     }
 
-    Write(AbstractValue &value) : value(value) {}
+    Write(AbstractValue &value) : Command(KIND), value(value) {}
 };
 
 /**
@@ -396,6 +499,8 @@ public:
  */
 class AbstractDeclaration : public Node {
 public:
+    AbstractDeclaration(NodeKind kind) : Node(kind) {}
+
     virtual ~AbstractDeclaration() {}
 
     virtual Node *copy(Callback replacer) = 0;
@@ -406,7 +511,9 @@ public:
  */
 class IdentifierDeclaration : public AbstractDeclaration {
 public:
-    std::string &name;
+    static const NodeKind KIND = IDENTIFIER_DECLARATION_NODE;
+
+    Symbol name;
 
     virtual std::string toString(int indentation);
 
@@ -414,7 +521,7 @@ public:
         return replacer(new IdentifierDeclaration(name));
     }
 
-    IdentifierDeclaration(std::string &name) : name(name) {}
+    IdentifierDeclaration(Symbol name) : AbstractDeclaration(KIND), name(name) {}
 };
 
 /**
@@ -422,7 +529,9 @@ public:
  */
 class ArrayDeclaration : public AbstractDeclaration {
 public:
-    std::string &name;
+    static const NodeKind KIND = ARRAY_DECLARATION_NODE;
+
+    Symbol name;
     long long start;
     long long end;
 
@@ -432,7 +541,7 @@ public:
         return replacer(new ArrayDeclaration(name, start, end));
     }
 
-    ArrayDeclaration(std::string &name, long long start, long long end) : name(name), start(start), end(end) {}
+    ArrayDeclaration(Symbol name, long long start, long long end) : AbstractDeclaration(KIND), name(name), start(start), end(end) {}
 };
 
 /**
@@ -440,7 +549,9 @@ public:
  */
 class DeclarationList : public Node {
 public:
-    std::vector<AbstractDeclaration *> declarations;
+    static const NodeKind KIND = DECLARATION_LIST_NODE;
+
+    std::vector<AbstractDeclaration *, ArenaAllocator<AbstractDeclaration *>> declarations;
 
     virtual std::string toString(int indentation);
 
@@ -454,30 +565,64 @@ public:
         return dclList;
     }
 
-    DeclarationList() {}
+    DeclarationList() : Node(KIND) {}
 };
 
 /**
- * Holds constants used across the program.
+ * Holds constants used across the program, each one only once (unrolled
+ * loops and folded expressions keep adding the same values).
  */
 class ConstantList {
+private:
+    std::unordered_set<long long> known;
 public:
     std::vector<long long> constants;
+
+    void add(long long value) {
+        if (known.insert(value).second) constants.push_back(value);
+    }
+
+    bool contains(long long value) const {
+        return known.count(value);
+    }
 };
 
 /**
- * A single analyzed program.
+ * A single analyzed program. It owns the arena its AST was parsed
+ * into, along with the code assembled from it (see ArenaObject), its
+ * symbol table and its constant list, so deleting it releases all of
+ * them at once.
+ * Whoever optimizes or assembles the program has to make its arena and
+ * symbols active first, and has to deactivate them before deleting the
+ * program.
  */
 class Program {
+private:
+    Arena *arena;
+    Symbols *symbols;
 public:
     DeclarationList &declarations;
     CommandList &commands;
     ConstantList &constants;
 
-    Program(DeclarationList &declarationList, CommandList &commandList, ConstantList &constantList)
-            : declarations(declarationList), commands(commandList), constants(constantList) {}
+    Program(DeclarationList &declarationList, CommandList &commandList, ConstantList &constantList, Arena *arena = nullptr, Symbols *symbols = nullptr)
+            : arena(arena), symbols(symbols), declarations(declarationList), commands(commandList), constants(constantList) {}
+
+    Arena *getArena() { return arena; }
+
+    Symbols *getSymbols() { return symbols; }
 
     std::string toString();
+
+    Program(const Program &) = delete;
+
+    Program &operator=(const Program &) = delete;
+
+    ~Program() {
+        delete &constants;
+        delete arena;
+        delete symbols;
+    }
 };
 
 #endif  //COMPILER_NODE_H
@@ -4,24 +4,26 @@
     #include <string>
     #include <vector>
     #include "ast/node.h"
-
-    extern int yylex();
-    extern int yyparse();
-    extern FILE *yyin;
-    extern int yylineno;
-    extern char* yytext;
-
-    void yyerror(const char *s);
-
-    DeclarationList *declarations = nullptr;
-    CommandList *commands = nullptr;
-    ConstantList *constants = new ConstantList();
 %}
 
 %code requires {
     #include "ast/node.h"
+    #include "parser/Parser.h"
+
+    typedef void *yyscan_t;
 }
 
+%code {
+    int yylex(YYSTYPE *yylval, yyscan_t scanner);
+    int yyget_lineno(yyscan_t scanner);
+
+    void yyerror(yyscan_t scanner, ParseState *state, const char *s);
+}
+
+%define api.pure full
+%lex-param { yyscan_t scanner }
+%parse-param { yyscan_t scanner } { ParseState *state }
+
 %union {
     int token;
 
@@ -35,7 +37,7 @@
     CommandList *cmd_list;
 
     long long numberValue;
-    std::string *stringValue;
+    Symbol symbol;
 }
 
 %token <token> DECLARE T_BEGIN END ASSIGN IF THEN ELSE ENDIF
@@ -47,7 +49,7 @@
 %token <token> ERROR
 
 %token <numberValue> NUMBER
-%token <stringValue> PIDENTIFIER
+%token <symbol> PIDENTIFIER
 
 %type <cmd> command;
 %type <ident> identifier;
@@ -60,30 +62,30 @@
 %%
 program:
     DECLARE declarations T_BEGIN commands END {
-        declarations = $2;
-        commands = $4;
+        state->declarations = $2;
+        state->commands = $4;
     }
     | T_BEGIN commands END {
-        commands = $2;
+        state->commands = $2;
     }
 ;
 
 declarations:
     declarations COMMA PIDENTIFIER {
-        $$->declarations.push_back(new IdentifierDeclaration(*$3));
+        $$->declarations.push_back(new IdentifierDeclaration($3));
     }
     | declarations COMMA PIDENTIFIER LBRACKET NUMBER COLON NUMBER RBRACKET {
-        constants->constants.push_back($5);
-        $$->declarations.push_back(new ArrayDeclaration(*$3, $5, $7));
+        state->constants->add($5);
+        $$->declarations.push_back(new ArrayDeclaration($3, $5, $7));
     }
     | PIDENTIFIER {
         $$ = new DeclarationList();
-        $$->declarations.push_back(new IdentifierDeclaration(*$1));
+        $$->declarations.push_back(new IdentifierDeclaration($1));
     }
     | PIDENTIFIER LBRACKET NUMBER COLON NUMBER RBRACKET {
         $$ = new DeclarationList();
-        constants->constants.push_back($3);
-        $$->declarations.push_back(new ArrayDeclaration(*$1, $3, $5));
+        state->constants->add($3);
+        $$->declarations.push_back(new ArrayDeclaration($1, $3, $5));
     }
 ;
 
@@ -114,10 +116,10 @@ command:
         $$ = new While(*$4, *$2, true);
     }
     | FOR PIDENTIFIER FROM value TO value DO commands ENDFOR {
-        $$ = new For(*$2, *$4, *$6, *$8);
+        $$ = new For($2, *$4, *$6, *$8);
     }
     | FOR PIDENTIFIER FROM value DOWNTO value DO commands ENDFOR {
-        $$ = new For(*$2, *$4, *$6, *$8, true);
+        $$ = new For($2, *$4, *$6, *$8, true);
     }
     | READ identifier SEMICOLON {
         $$ = new Read(*$2);
@@ -171,7 +173,7 @@ condition:
 
 value:
     NUMBER {
-        constants->constants.push_back($1);
+        state->constants->add($1);
         $$ = new NumberValue($1);
     } | identifier {
         $$ = new IdentifierValue(*$1);
@@ -180,22 +182,20 @@ value:
 
 identifier:
     PIDENTIFIER {
-        $$ = new VariableIdentifier(*$1);
+        $$ = new VariableIdentifier($1);
     }
     | PIDENTIFIER LBRACKET PIDENTIFIER RBRACKET {
-        $$ = new VariableAccessIdentifier(*$1, *$3);
+        $$ = new VariableAccessIdentifier($1, $3);
     }
     | PIDENTIFIER LBRACKET NUMBER RBRACKET {
-        constants->constants.push_back($3);
-        $$ = new AccessIdentifier(*$1, $3);
+        state->constants->add($3);
+        $$ = new AccessIdentifier($1, $3);
     }
 ;
 %%
 
 
 
-void yyerror(const char *s) {
-  std::cout << "   [e] " << s << " at line " << yylineno << std::endl;
-  std::cout << "[e] Aborting" << std::endl;
-  exit(1);
+void yyerror(yyscan_t scanner, ParseState *state, const char *s) {
+    state->error = std::string(s) + " at line " + std::to_string(yyget_lineno(scanner));
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "Parser.h"
+#include "../compiler.tab.h"
+
+/*
+ * Generated by flex (see compiler.l); declared here by hand to keep the
+ * scanner's header out of the rest of the compiler.
+ */
+int yylex(YYSTYPE *value, void *scanner);
+
+int yylex_init_extra(ParseState *state, void **scanner);
+
+void yyset_in(FILE *source, void *scanner);
+
+struct yy_buffer_state *yy_scan_bytes(const char *bytes, int length, void *scanner);
+
+struct yy_buffer_state *yy_scan_buffer(char *base, size_t size, void *scanner);
+
+int yylex_destroy(void *scanner);
+
+Program *Parser::parse(FILE *source) {
+    ParseState state;
+    void *scanner;
+    yylex_init_extra(&state, &scanner);
+    yyset_in(source, scanner);
+
+    return parse(scanner, state);
+}
+
+Program *Parser::parse(std::string_view source) {
+    ParseState state;
+    void *scanner;
+    yylex_init_extra(&state, &scanner);
+    yy_scan_bytes(source.data(), source.size(), scanner); // the buffer is released by yylex_destroy
+
+    return parse(scanner, state);
+}
+
+Program *Parser::parse(SourceFile &source) {
+    ParseState state;
+    void *scanner;
+    yylex_init_extra(&state, &scanner);
+    yy_scan_buffer(source.scanBuffer(), source.scanBufferSize(), scanner);
+
+    return parse(scanner, state);
+}
+
+Program *Parser::parse(void *scanner, ParseState &state) {
+    Arena *arena = new Arena(); // the whole AST lives here, Program releases it when deleted
+    Arena *previousArena = Arena::getActive();
+    Arena::setActive(arena);
+
+    Symbols *symbols = new Symbols(); // and so do the identifiers the lexer interns
+    Symbols *previousSymbols = Symbols::getActive();
+    Symbols::setActive(symbols);
+
+    int result = yyparse(scanner, &state);
+
+    yylex_destroy(scanner);
+
+    if (result != 0) {
+        Arena::setActive(previousArena);
+        Symbols::setActive(previousSymbols);
+        delete arena;
+        delete symbols;
+        delete state.constants;
+        throw state.error.empty() ? std::string("Parsing failed") : state.error;
+    }
+
+    if (state.commands == nullptr) state.commands = new CommandList();
+    if (state.declarations == nullptr) state.declarations = new DeclarationList();
+    Arena::setActive(previousArena); // whoever uses the program makes them active again, see Program
+    Symbols::setActive(previousSymbols);
+
+    return new Program(*state.declarations, *state.commands, *state.constants, arena, symbols);
+}
+
+std::string Parser::tokens(std::string_view source) {
+    Symbols symbols; // the names are only needed until they're written out
+    Symbols *previousSymbols = Symbols::getActive();
+    Symbols::setActive(&symbols);
+
+    ParseState state;
+    void *scanner;
+    yylex_init_extra(&state, &scanner);
+    yy_scan_bytes(source.data(), source.size(), scanner);
+
+    std::string tokens;
+    tokens.reserve(source.size() / 2);
+
+    YYSTYPE value;
+    for (int token = yylex(&value, scanner); token != 0; token = yylex(&value, scanner)) {
+        tokens += std::to_string(token);
+        if (token == PIDENTIFIER) tokens += " " + Symbols::name(value.symbol);
+        if (token == NUMBER) tokens += " " + std::to_string(value.numberValue);
+        tokens += '\n';
+    }
+
+    yylex_destroy(scanner);
+    delete state.constants;
+    Symbols::setActive(previousSymbols);
+    return tokens;
+}
@@ -0,0 +1,69 @@
+#include "../ast/node.h"
+#include "SourceFile.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#ifndef COMPILER_PARSER_H
+#define COMPILER_PARSER_H
+
+/**
+ * Everything a single parse produces; it's passed through the (pure)
+ * bison parser and the (reentrant) flex scanner instead of globals, so
+ * any number of files can be parsed at the same time.
+ */
+struct ParseState {
+    DeclarationList *declarations = nullptr;
+    CommandList *commands = nullptr;
+    ConstantList *constants = new ConstantList();
+
+    /**
+     * Syntax error message; empty if there was none.
+     */
+    std::string error;
+};
+
+/**
+ * The front end's entry point.
+ */
+class Parser {
+private:
+    /**
+     * Runs the parser on a scanner set up with its input; destroys the
+     * scanner afterwards.
+     */
+    static Program *parse(void *scanner, ParseState &state);
+
+public:
+    /**
+     * Parses a whole source file into a Program. Its AST is placed in a
+     * new Arena and its identifiers in new Symbols, both owned by the
+     * program; the ones active before are active again afterwards.
+     * @param source Opened source file.
+     * @return Parsed program.
+     * @throws std::string with the syntax error.
+     */
+    static Program *parse(FILE *source);
+
+    /**
+     * Parses source text held in memory; see parse(FILE *).
+     * @param source Program's text; it's copied by the scanner, so it
+     * doesn't need to be null-terminated.
+     */
+    static Program *parse(std::string_view source);
+
+    /**
+     * Parses a mapped source file in place, with no copying; see parse(FILE *).
+     */
+    static Program *parse(SourceFile &source);
+
+    /**
+     * Scans source text without parsing it.
+     * @return The source's tokens as text, one per line, with comments,
+     * whitespace and formatting dropped: two sources with the same
+     * tokens compile to the same code.
+     */
+    static std::string tokens(std::string_view source);
+};
+
+#endif //COMPILER_PARSER_H
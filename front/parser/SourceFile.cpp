@@ -0,0 +1,65 @@
+#include "SourceFile.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(const std::string &path) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) throw "Can't open " + path + ": " + strerror(errno);
+
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+        size = status.st_size;
+
+        // Zeroed anonymous pages first, then the file over their beginning: the null bytes after the text are
+        // there even if the text ends exactly at a page boundary, where mapping past the file's end would fault.
+        size_t pageSize = sysconf(_SC_PAGESIZE);
+        mappedLength = (size + 2 + pageSize - 1) / pageSize * pageSize;
+        void *reserved = mmap(nullptr, mappedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved != MAP_FAILED && size > 0) {
+            if (mmap(reserved, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, descriptor, 0) == MAP_FAILED) {
+                munmap(reserved, mappedLength);
+                reserved = MAP_FAILED;
+            }
+        }
+
+        if (reserved != MAP_FAILED) {
+            data = static_cast<char *>(reserved);
+            close(descriptor);
+            return;
+        }
+        mappedLength = 0;
+    }
+
+    size = 0; // not mappable, read it all instead
+    size_t capacity = 1 << 16;
+    data = static_cast<char *>(malloc(capacity));
+    while (true) {
+        if (size + 2 >= capacity) data = static_cast<char *>(realloc(data, capacity *= 2));
+
+        ssize_t result = read(descriptor, data + size, capacity - size - 2);
+        if (result < 0 && errno == EINTR) continue;
+        if (result < 0) {
+            std::string error = "Can't read " + path + ": " + strerror(errno);
+            close(descriptor);
+            free(data);
+            throw error;
+        }
+        if (result == 0) break;
+        size += result;
+    }
+    data[size] = data[size + 1] = '\0';
+    close(descriptor);
+}
+
+SourceFile::~SourceFile() {
+    if (mappedLength > 0) {
+        munmap(data, mappedLength);
+    } else {
+        free(data);
+    }
+}
@@ -0,0 +1,49 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#ifndef COMPILER_SOURCEFILE_H
+#define COMPILER_SOURCEFILE_H
+
+/**
+ * A source file mapped into memory, so the scanner can work on it in
+ * place (see Parser::parse(SourceFile &)) instead of copying it through
+ * stdio buffers. The mapping is private and writable, as flex marks
+ * token ends in its buffer; the file itself is never changed. The text
+ * is followed by the two null bytes flex requires at the buffer's end.
+ * Files that can't be mapped (e.g. pipes) are read into memory instead.
+ */
+class SourceFile {
+private:
+    char *data = nullptr;
+    size_t size = 0;
+
+    /**
+     * Length of the mapping; 0 when the text was read into the heap.
+     */
+    size_t mappedLength = 0;
+
+public:
+    /**
+     * @param path File to open.
+     * @throws std::string when the file can't be opened or read.
+     */
+    SourceFile(const std::string &path);
+
+    SourceFile(const SourceFile &) = delete;
+
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    std::string_view text() const { return std::string_view(data, size); }
+
+    /**
+     * @return The text together with the trailing null bytes, for yy_scan_buffer.
+     */
+    char *scanBuffer() { return data; }
+
+    size_t scanBufferSize() const { return size + 2; }
+
+    ~SourceFile();
+};
+
+#endif //COMPILER_SOURCEFILE_H
@@ -1,132 +1,67 @@
 #include <iostream>
-#include <fstream>
-#include <chrono>
-#include "front/ast/node.h"
-#include "middle/abstract_assembler/AbstractAssembler.h"
-#include "middle/ast_optimizer/ASTOptimizer.h"
-#include "middle/peephole/PeepholeOptimizer.h"
-
-extern DeclarationList *declarations;
-extern CommandList *commands;
-extern ConstantList *constants;
-
-extern int yyparse();
-
-extern FILE *yyin;
-
-bool warning = false;
+#include <cstdlib>
+#include <string>
+#include "driver/Compiler.h"
+#include "driver/Batch.h"
+#include "driver/Server.h"
 
 int main(int argc, char **argv) {
-    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-
     if (argc < 2) {
-        std::cerr << "[i] Usage: compiler <source> [destination] [optimize=(0|1)]" << std::endl;
+        std::cerr << "[i] Usage: compiler <source> [destination] [-o (no optimization)] [-v (verbose)] [-u<unroll budget>] [-m (memory-mapped output)] [--stats] [--trace=<file.json>] [--cache=<directory>] [--cache-size=<MiB>]" << std::endl;
+        std::cerr << "[i]        compiler --batch <directory> [-j<threads>] [options]" << std::endl;
+        std::cerr << "[i]        compiler --serve <socket | - (standard streams)> [-j<threads>] [options]" << std::endl;
         return 1;
     }
 
-    FILE *source = fopen(argv[1], "r");
-    if (!source) {
-        std::cerr << "[e] Can't open " << argv[1] << std::endl;
-        return 1;
+    CompilerOptions options;
+    std::string sourcePath, outputPath = "a.out", batchDirectory, socketPath;
+    int jobs = 0;
+    bool outputGiven = false;
+    for (int i = 1; i < argc; i++) {
+        std::string argument(argv[i]);
+
+        if (argument == "--stats") options.printStats = true;
+        else if (argument.rfind("--trace=", 0) == 0) options.tracePath = argument.substr(8);
+        else if (argument.rfind("--cache=", 0) == 0) options.cacheDirectory = argument.substr(8);
+        else if (argument.rfind("--cache-size=", 0) == 0) options.cacheLimit = atoll(argv[i] + 13) * 1024 * 1024; // in MiB
+        else if (argument == "--batch" && i + 1 < argc) batchDirectory = argv[++i];
+        else if (argument == "--serve" && i + 1 < argc) socketPath = argv[++i];
+        else if (argument == "-j" && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (argument.rfind("-j", 0) == 0) jobs = atoi(argv[i] + 2); // e.g. -j8
+        else if (argument.rfind("--", 0) == 0) continue;
+        else if (argv[i][0] == '-' && argv[i][1] == 'v') options.verbose = true;
+        else if (argv[i][0] == '-' && argv[i][1] == 'o') options.optimize = false;
+        else if (argv[i][0] == '-' && argv[i][1] == 'u') options.unrollBudget = atoll(argv[i] + 2); // e.g. -u1000
+        else if (argv[i][0] == '-' && argv[i][1] == 'm') options.mapOutput = true;
+        else if (sourcePath.empty()) sourcePath = argument;
+        else if (!outputGiven) outputPath = argument, outputGiven = true;
     }
 
-    bool optimize = true, verbose = false;
-    for (int i = 0; i < argc; i++) {
-        if (argv[i][0] == '-' && argv[i][1] == 'v') verbose = true;
-        if (argv[i][0] == '-' && argv[i][1] == 'o') optimize = false;
+    if ((!batchDirectory.empty() || !socketPath.empty()) && !options.tracePath.empty()) {
+        std::cerr << "[w] --trace is only supported for a single file" << std::endl;
+        options.tracePath.clear();
     }
 
-    std::cout << "[i] Compiling file " << argv[1] << (optimize ? " with optimization" : " without optimization") << std::endl;
-
-    std::cout << "[i] Parsing... " << std::endl;
-
-    yyin = source;
-    yyparse();
-
-    std::cout << "   [i] done" << std::endl;
-
-    if (commands == nullptr) commands = new CommandList();
-    if (declarations == nullptr) declarations = new DeclarationList();
-
-    Program *program = new Program(*declarations, *commands, *constants);
-
-    if (verbose) std::cout << "-=- A S T -=-" << std::endl;
-    if (verbose) std::cout << program->toString() << std::endl;
-
-    if (optimize) {
-        std::cout << "[i] AST Optimization... " << std::endl;
-        if (verbose) std::cout << std::endl;
-        ASTOptimizer *astOptimizer = new ASTOptimizer(program);
-        astOptimizer->optimize(verbose);
-        if (verbose) std::cout << std::endl;
-        std::cout << "   [i] done" << std::endl;
-
-        if (verbose) std::cout << "-=- OPTIMIZED A S T -=-" << std::endl;
-        if (verbose) std::cout << program->toString() << std::endl;
-    }
-
-    AbstractAssembler *assembler = new AbstractAssembler(*program);
-
-    std::cout << "[i] Compiling... " << std::endl;
-    if (verbose) std::cout << std::endl;
-
-    try {
-        InstructionList &assembled = assembler->assemble(verbose);
-
-        std::cout << "   [i] done" << std::endl;
-
-        if (verbose) std::cout << std::endl << "-=- A S M -=-" << std::endl;
-
-        std::ofstream output;
-        output.open(argv[2] ? argv[2] : "a.out");
-
-        for (const auto &ins : assembled.getInstructions()) {
-            if (!ins->stub) {
-                if (verbose) std::cout << std::setbase(10) << ins->getAddress() << ": " << ins->toAssemblyCode(true) << std::endl;
-                if (!optimize) output << ins->toAssemblyCode(true) << std::endl;
-            }
+    if (!socketPath.empty()) {
+        CompileServer server(options, jobs);
+        try {
+            if (socketPath == "-") server.serveStandardStreams();
+            else server.listen(socketPath);
+        } catch (std::string errorMessage) {
+            std::cerr << "[e] " << errorMessage << std::endl;
+            return 1;
         }
+        return 0;
+    }
 
-        if (optimize) {
-            std::cout << "[i] ASM Optimization... " << std::endl;
-            if (verbose) std::cout << std::endl;
-            PeepholeOptimizer *peepholeOptimizer = new PeepholeOptimizer(assembled);
-
-            peepholeOptimizer->optimize(verbose);
-            assembled.seal(false);
-
-            if (verbose) std::cout << std::endl;
-            std::cout << "   [i] done" << std::endl;
-
-            if (verbose) std::cout << std::endl << "-=- OPTIMIZED A S M -=-" << std::endl;
-
-            for (const auto &ins : assembled.getInstructions()) {
-                if (!ins->stub) {
-                    if (verbose) std::cout << std::setbase(10) << ins->getAddress() << ": " << ins->toAssemblyCode(true) << std::endl;
-                    output << ins->toAssemblyCode(true) << std::endl;
-                }
-            }
-            output.close();
-        }
-
-        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-
-        if (warning) {
-            std::cout << "[w] Compiled with warnings in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << std::endl;
-
-        } else {
-            std::cout << "[i] Compiled successfully in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << " ms" << std::endl;
-        }
+    if (!batchDirectory.empty()) {
+        return BatchCompiler(options, jobs).compileDirectory(batchDirectory) == 0 ? 0 : 1;
+    }
 
-    } catch (std::string errorMessage) {
-        std::cout << "   [e] " << errorMessage << std::endl;
-        std::cout << "[e] Aborting" << std::endl;
-        return 1;
-    } catch (char const *errorMessage) {
-        std::cout << "   [e] " << errorMessage << std::endl;
-        std::cout << "[e] Aborting" << std::endl;
+    if (sourcePath.empty()) {
+        std::cerr << "[e] No source file given" << std::endl;
         return 1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    return Compiler(options).compileFile(sourcePath, outputPath, std::cout) == COMPILATION_FAILED ? 1 : 0;
+}
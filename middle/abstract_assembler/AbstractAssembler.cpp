@@ -1,8 +1,5 @@
 #include "AbstractAssembler.h"
 
-std::string TEMPORARY_NAMES = "!TEMP";
-extern bool warning;
-
 void AbstractAssembler::prepareConstants(bool verbose) {
     constants = new Constants(accumulatorNumber);
 
@@ -10,7 +7,7 @@ void AbstractAssembler::prepareConstants(bool verbose) {
         Constant *constantPointer = constants->addConstant(num);
 
         if (constantPointer && verbose) {
-            std::cout << constantPointer->toString() << std::endl;
+            Diagnostics::out() << constantPointer->toString() << std::endl;
         }
     }
 }
@@ -18,11 +15,8 @@ void AbstractAssembler::prepareConstants(bool verbose) {
 InstructionList &AbstractAssembler::assembleConstants() {
     InstructionList &list = constants->oneAndMinusOne(primaryAccumulator);
 
-    for (const auto &constant : constants->getConstants()) {
-        InstructionList &generatedCode = constant->generateConstant(constants, primaryAccumulator, secondaryAccumulator);
-
-        list.append(generatedCode);
-    }
+    ConstantPlanner planner(constants, primaryAccumulator);
+    list.append(planner.generate());
 
     return list;
 }
@@ -36,38 +30,36 @@ void AbstractAssembler::getVariablesFromDeclarations(bool verbose) {
     );
 
     for (const auto &declaration : program.declarations.declarations) {
-        if (auto numDecl = dynamic_cast<IdentifierDeclaration *>(declaration)) {
+        if (auto numDecl = declaration->as<IdentifierDeclaration>()) {
             NumberVariable *var = new NumberVariable(numDecl->name, *new ResolvableAddress());
             scopedVariables->pushVariableScope(var);
-            if (verbose) std::cout << var->toString() << std::endl;
-        } else if (auto arrDecl = dynamic_cast<ArrayDeclaration *>(declaration)) {
+            if (verbose) Diagnostics::out() << var->toString() << std::endl;
+        } else if (auto arrDecl = declaration->as<ArrayDeclaration>()) {
             NumberArrayVariable *var = new NumberArrayVariable(arrDecl->name, *new ResolvableAddress(), arrDecl->start, arrDecl->end);
             scopedVariables->pushVariableScope(var);
-            if (verbose) std::cout << var->toString() << std::endl;
+            if (verbose) Diagnostics::out() << var->toString() << std::endl;
 
             // this is an array start address; it must be included in generated constants to use with indirect
             // variable addressing mode (e.g. a[b])
             // constants are to be generated in the next step, based on program constants
             // this isn't the best solutions and should be changed one day
-            program.constants.constants.push_back(var->getAddress().getAddress());
+            program.constants.add(var->getAddress().getAddress());
         }
     }
 }
 
 void AbstractAssembler::removeUselessConstants(InstructionList &instructions) {
-    std::vector < Constant * > toRemove;
+    std::unordered_set<ResolvableAddress *> usedAddresses; // a single pass over the program collects every address in use
 
-    for (auto const &constant : constants->getConstants()) {
-        bool found = false;
-        for (auto const &ins : instructions.getInstructions()) {
-            if (auto addrIns = dynamic_cast<InstructionUsingAddress *>(ins)) {
-                if (&addrIns->address == &constant->getAddress()) {
-                    found = true;
-                    break;
-                }
-            }
+    for (auto const &ins : instructions.getInstructions()) {
+        if (auto addrIns = dynamic_cast<InstructionUsingAddress *>(ins)) {
+            usedAddresses.insert(&addrIns->address);
         }
-        if (!found) {
+    }
+
+    std::vector<Constant *> toRemove;
+    for (auto const &constant : constants->getConstants()) {
+        if (!usedAddresses.count(&constant->getAddress())) {
             toRemove.push_back(constant);
         }
     }
@@ -84,148 +76,215 @@ SimpleResolution *AbstractAssembler::assembleCommands(CommandList &commandList)
     for (const auto &command : commandList.commands) {
         long long tempVars = 0;
 
-        if (auto commandList = dynamic_cast<CommandList *>(command)) { // NESTED COMMANDLIST
-            SimpleResolution *assmebledCommands = assembleCommands(*commandList);
-            instructions.append(assmebledCommands->instructions);
-            tempVars += assmebledCommands->temporaryVars;
-        } else if (auto readNode = dynamic_cast<Read *>(command)) { // READ
-            Resolution *idRes = resolve(readNode->identifier, false);
-
-            if (!idRes->writable) throw "Trying to read to non-writable variable " + readNode->identifier.name;
-
-            Get *get = new Get();
-            if (idRes->indirect) {
-                TemporaryVariable *tempAddressVar = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                scopedVariables->pushVariableScope(tempAddressVar);
-
-                instructions.append(idRes->instructions).append(new Store(tempAddressVar->getAddress())).append(get).append(new Storei(tempAddressVar->getAddress()));
-                tempVars += 1;
-            } else {
-                instructions.append(get).append(new Store(idRes->address));
+        switch (command->kind) {
+            case COMMAND_LIST_NODE: { // NESTED COMMANDLIST
+                SimpleResolution *assmebledCommands = assembleCommands(*static_cast<CommandList *>(command));
+                instructions.append(assmebledCommands->instructions);
+                tempVars += assmebledCommands->temporaryVars;
+                break;
             }
+            case READ_NODE: { // READ
+                auto readNode = static_cast<Read *>(command);
+                Resolution *idRes = resolve(readNode->identifier, false);
+
+                if (!idRes->writable) throw "Trying to read to non-writable variable " + Symbols::name(readNode->identifier.name);
+
+                Get *get = new Get();
+                if (idRes->indirect && &idRes->address != &primaryAccumulator) { // a derived pointer already holds the address
+                    instructions.append(get).append(new Storei(idRes->address));
+                } else if (idRes->indirect) {
+                    TemporaryVariable *tempAddressVar = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    scopedVariables->pushVariableScope(tempAddressVar);
+
+                    instructions.append(idRes->instructions).append(new Store(tempAddressVar->getAddress())).append(get).append(new Storei(tempAddressVar->getAddress()));
+                    tempVars += 1;
+                } else {
+                    instructions.append(get).append(new Store(idRes->address));
+                }
 
-            tempVars += idRes->temporaryVars;
-        } else if (auto writeNode = dynamic_cast<Write *>(command)) { // WRITE
-            Resolution *valRes = resolve(writeNode->value);
-            Put *put = new Put();
-
-            if (valRes->indirect) {
-                instructions.append(valRes->instructions).append(new Loadi(primaryAccumulator)).append(put);
-            } else {
-                instructions.append(new Load(valRes->address)).append(put);
+                tempVars += idRes->temporaryVars;
+                break;
             }
+            case WRITE_NODE: { // WRITE
+                auto writeNode = static_cast<Write *>(command);
+                Resolution *valRes = resolve(writeNode->value);
+                Put *put = new Put();
+
+                if (valRes->indirect) {
+                    instructions.append(valRes->instructions).append(new Loadi(valRes->address)).append(put);
+                } else {
+                    instructions.append(new Load(valRes->address)).append(put);
+                }
 
-            tempVars += valRes->temporaryVars;
-        } else if (auto assignNode = dynamic_cast<Assignment *>(command)) { // ASSIGN
-            Resolution *idRes = resolve(assignNode->identifier, false);
-
-            if (!idRes->writable) throw "Trying to assign to non-writable variable " + assignNode->identifier.name;
-
-            SimpleResolution *expRes = assembleExpression(assignNode->expression);
-
-            if (idRes->indirect) {
-                TemporaryVariable *tempAddressVar = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                scopedVariables->pushVariableScope(tempAddressVar);
-
-                instructions.append(idRes->instructions).append(new Store(tempAddressVar->getAddress())).append(expRes->instructions).append(new Storei(tempAddressVar->getAddress()));
-                tempVars += 1;
-            } else {
-                instructions.append(expRes->instructions).append(new Store(idRes->address));
+                tempVars += valRes->temporaryVars;
+                break;
             }
+            case ASSIGNMENT_NODE: { // ASSIGN
+                auto assignNode = static_cast<Assignment *>(command);
+                Resolution *idRes = resolve(assignNode->identifier, false);
 
-            tempVars += idRes->temporaryVars + expRes->temporaryVars;
-        } else if (auto ifNode = dynamic_cast<If *>(command)) { // IF
-            SimpleResolution *codeResolution = assembleCommands(ifNode->commands); // assemble inner instructions
-            SimpleResolution *conditionResolution = assembleCondition(ifNode->condition, codeResolution->instructions); // assemble condition
-
-            instructions.append(conditionResolution->instructions) // add condition code
-                    .append(codeResolution->instructions); // add inner block code
-
-            tempVars += conditionResolution->temporaryVars;
-        } else if (auto ifElseNode = dynamic_cast<IfElse *>(command)) { // IF ELSE
-            SimpleResolution *ifCodeResolution = assembleCommands(ifElseNode->commands);
-            SimpleResolution *conditionResolution = assembleCondition(ifElseNode->condition, ifCodeResolution->instructions);
-            SimpleResolution *elseCodeResolution = assembleCommands(ifElseNode->elseCommands);
+                if (!idRes->writable) throw "Trying to assign to non-writable variable " + Symbols::name(assignNode->identifier.name);
 
-            Jump *jump = new Jump(elseCodeResolution->instructions.end());
-            ifCodeResolution->instructions.append(jump);
+                SimpleResolution *expRes = assembleExpression(assignNode->expression);
 
-            instructions.append(conditionResolution->instructions)
-                    .append(ifCodeResolution->instructions)
-                    .append(elseCodeResolution->instructions);
+                if (idRes->indirect && &idRes->address != &primaryAccumulator) { // a derived pointer already holds the address
+                    instructions.append(expRes->instructions).append(new Storei(idRes->address));
+                } else if (idRes->indirect) {
+                    TemporaryVariable *tempAddressVar = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    scopedVariables->pushVariableScope(tempAddressVar);
 
-            tempVars += conditionResolution->temporaryVars;
-        } else if (auto whileNode = dynamic_cast<While *>(command)) { // WHILE
-            SimpleResolution *codeResolution = assembleCommands(whileNode->commands);
+                    instructions.append(idRes->instructions).append(new Store(tempAddressVar->getAddress())).append(expRes->instructions).append(new Storei(tempAddressVar->getAddress()));
+                    tempVars += 1;
+                } else {
+                    instructions.append(expRes->instructions).append(new Store(idRes->address));
+                }
 
-            if (whileNode->doWhile) {
-                InstructionList *jumpBlock = new InstructionList();
-                Jump *jump = new Jump(codeResolution->instructions.start());
-                jumpBlock->append(jump);
+                tempVars += idRes->temporaryVars + expRes->temporaryVars;
+                break;
+            }
+            case IF_NODE: { // IF
+                auto ifNode = static_cast<If *>(command);
+                SimpleResolution *codeResolution = assembleCommands(ifNode->commands); // assemble inner instructions
+                SimpleResolution *conditionResolution = assembleCondition(ifNode->condition, codeResolution->instructions); // assemble condition
 
-                SimpleResolution *conditionResolution = assembleCondition(whileNode->condition, *jumpBlock);
-                instructions.append(codeResolution->instructions)
-                        .append(conditionResolution->instructions)
-                        .append(*jumpBlock);
+                instructions.append(conditionResolution->instructions) // add condition code
+                        .append(codeResolution->instructions); // add inner block code
 
                 tempVars += conditionResolution->temporaryVars;
-            } else {
-                SimpleResolution *conditionResolution = assembleCondition(whileNode->condition, codeResolution->instructions);
-                Jump *jump = new Jump(conditionResolution->instructions.start());
-                codeResolution->instructions.append(jump);
+                break;
+            }
+            case IF_ELSE_NODE: { // IF ELSE
+                auto ifElseNode = static_cast<IfElse *>(command);
+                SimpleResolution *ifCodeResolution = assembleCommands(ifElseNode->commands);
+                SimpleResolution *conditionResolution = assembleCondition(ifElseNode->condition, ifCodeResolution->instructions);
+                SimpleResolution *elseCodeResolution = assembleCommands(ifElseNode->elseCommands);
+
+                Jump *jump = new Jump(elseCodeResolution->instructions.end());
+                ifCodeResolution->instructions.append(jump);
 
                 instructions.append(conditionResolution->instructions)
-                        .append(codeResolution->instructions);
+                        .append(ifCodeResolution->instructions)
+                        .append(elseCodeResolution->instructions);
 
                 tempVars += conditionResolution->temporaryVars;
+                break;
             }
-        } else if (auto forNode = dynamic_cast<For *>(command)) {
-            NumberVariable *iterator = new NumberVariable(
-                    forNode->variableName,
-                    *new ResolvableAddress(),
-                    true
-            );
-            iterator->initialized = true;
-            scopedVariables->pushVariableScope(iterator); // create iterator BEFORE commands would use it
-            tempVars += 1;
+            case WHILE_NODE: { // WHILE
+                auto whileNode = static_cast<While *>(command);
+                SimpleResolution *codeResolution = assembleCommands(whileNode->commands);
+
+                if (whileNode->doWhile) {
+                    InstructionList *jumpBlock = new InstructionList();
+                    Jump *jump = new Jump(codeResolution->instructions.start());
+                    jumpBlock->append(jump);
+
+                    SimpleResolution *conditionResolution = assembleCondition(whileNode->condition, *jumpBlock);
+                    instructions.append(codeResolution->instructions)
+                            .append(conditionResolution->instructions)
+                            .append(*jumpBlock);
+
+                    tempVars += conditionResolution->temporaryVars;
+                } else {
+                    SimpleResolution *conditionResolution = assembleCondition(whileNode->condition, codeResolution->instructions);
+                    Jump *jump = new Jump(conditionResolution->instructions.start());
+                    codeResolution->instructions.append(jump);
+
+                    instructions.append(conditionResolution->instructions)
+                            .append(codeResolution->instructions);
+
+                    tempVars += conditionResolution->temporaryVars;
+                }
+                break;
+            }
+            case FOR_NODE: { // FOR
+                auto forNode = static_cast<For *>(command);
+                NumberVariable *iterator = new NumberVariable(
+                        forNode->variableName,
+                        *new ResolvableAddress(),
+                        true
+                );
+                iterator->initialized = true;
+                scopedVariables->pushVariableScope(iterator); // create iterator BEFORE commands would use it
+                tempVars += 1;
 
-            Resolution *startRes = resolve(forNode->startValue); // resolve start and end
-            Resolution *endRes = resolve(forNode->endValue);
-            tempVars += startRes->temporaryVars + endRes->temporaryVars;
+                Resolution *startRes = resolve(forNode->startValue); // resolve start and end
+                Resolution *endRes = resolve(forNode->endValue);
+                tempVars += startRes->temporaryVars + endRes->temporaryVars;
 
-            ResolvableAddress *iterationEndAddress; // we will need it in comparing
+                ResolvableAddress *iterationEndAddress; // we will need it in comparing
 
-            if (endRes->type == CONSTANT) {
-                iterationEndAddress = &endRes->address;
-            } else {
-                TemporaryVariable *iterationEnd = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                scopedVariables->pushVariableScope(iterationEnd);
-                tempVars += 1;
+                if (endRes->type == CONSTANT) {
+                    iterationEndAddress = &endRes->address;
+                } else {
+                    TemporaryVariable *iterationEnd = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    scopedVariables->pushVariableScope(iterationEnd);
+                    tempVars += 1;
 
-                iterationEndAddress = &iterationEnd->getAddress();
+                    iterationEndAddress = &iterationEnd->getAddress();
 
-                instructions.append(endRes->instructions)
-                        .append(endRes->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(endRes->address)))
-                        .append(new Store(*iterationEndAddress));
-            }
+                    instructions.append(endRes->instructions)
+                            .append(endRes->indirect ? static_cast<Instruction *>(new Loadi(endRes->address)) : static_cast<Instruction *>(new Load(endRes->address)))
+                            .append(new Store(*iterationEndAddress));
+                }
+
+                // a[i] gets a pointer of its own, moved along with the iterator, so accessing it is a single LOADI/STOREI
+                std::vector<std::pair<Symbol, double>> accesses;
+                countArrayAccesses(&forNode->commands, forNode->variableName, accesses, 1);
+
+                InstructionList &pointerInstructions = *new InstructionList();
+                size_t outerPointers = derivedPointers.size();
+                for (auto const &access : accesses) {
+                    NumberArrayVariable *arrayVar = nullptr;
+                    if (Variable *variable = scopedVariables->findVariable(access.first)) arrayVar = variable->as<NumberArrayVariable>();
+                    if (!arrayVar || access.second < 1) continue; // let resolve complain; or an access too rare to pay for moving the pointer
+
+                    TemporaryVariable *pointer = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    scopedVariables->pushVariableScope(pointer);
+                    tempVars += 1;
+                    derivedPointers.push_back(DerivedPointer{access.first, forNode->variableName, pointer});
+
+                    pointerInstructions.append(new Load(iterator->getAddress())) // &a[i] = &a + i - start
+                            .append(new Sub(constants->getConstant(arrayVar->start)->getAddress()))
+                            .append(new Add(constants->getConstant(arrayVar->getAddress().getAddress())->getAddress()))
+                            .append(new Store(pointer->getAddress()));
+                }
+                if (derivedPointers.size() > outerPointers) pointerInstructions.append(new Load(iterator->getAddress())); // the check expects the iterator
+                Stats::count("derived pointers", derivedPointers.size() - outerPointers);
+
+                InstructionList &codeInstructions = *new InstructionList();
+                for (long long copy = 0; copy < forNode->unroll; copy++) { // a partially unrolled loop repeats its commands between the checks
+                    SimpleResolution *codeResolution = assembleCommands(forNode->commands); // assemble iterated commands
+                    codeInstructions.append(codeResolution->instructions);
+
+                    for (size_t i = outerPointers; i < derivedPointers.size(); i++) {
+                        codeInstructions.append(new Load(derivedPointers[i].pointer->getAddress()))
+                                .append(forNode->reversed ? static_cast<Instruction *>(new Dec()) : static_cast<Instruction *>(new Inc()))
+                                .append(new Store(derivedPointers[i].pointer->getAddress()));
+                    }
 
-            SimpleResolution *codeResolution = assembleCommands(forNode->commands); // assemble iterated commands
+                    codeInstructions.append(new Load(iterator->getAddress()))
+                            .append(forNode->reversed ? static_cast<Instruction *>(new Dec()) : static_cast<Instruction *>(new Inc()))
+                            .append(new Store(iterator->getAddress()));
+                }
 
-            InstructionList &forLoopInstructions = *new InstructionList();
-            forLoopInstructions.append(new Sub(*iterationEndAddress))
-                    .append(forNode->reversed ? static_cast<Instruction *>(new Jneg(codeResolution->instructions.end())) : static_cast<Instruction *>(new Jpos(codeResolution->instructions.end())));
+                InstructionList &forLoopInstructions = *new InstructionList();
+                forLoopInstructions.append(new Sub(*iterationEndAddress))
+                        .append(forNode->reversed ? static_cast<Instruction *>(new Jneg(codeInstructions.end())) : static_cast<Instruction *>(new Jpos(codeInstructions.end())));
 
-            codeResolution->instructions.append(new Load(iterator->getAddress()))
-                    .append(forNode->reversed ? static_cast<Instruction *>(new Dec()) : static_cast<Instruction *>(new Inc()))
-                    .append(new Store(iterator->getAddress()))
-                    .append(new Jump(forLoopInstructions.start()));
+                codeInstructions.append(new Jump(forLoopInstructions.start()));
+                derivedPointers.resize(outerPointers);
 
-            instructions.append(startRes->instructions) // load start instructions
-                    .append(startRes->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(startRes->address)))
-                    .append(new Store(iterator->getAddress())); // store it in the iterator
+                instructions.append(startRes->instructions) // load start instructions
+                        .append(startRes->indirect ? static_cast<Instruction *>(new Loadi(startRes->address)) : static_cast<Instruction *>(new Load(startRes->address)))
+                        .append(new Store(iterator->getAddress())) // store it in the iterator
+                        .append(pointerInstructions);
 
-            instructions.append(forLoopInstructions)
-                    .append(codeResolution->instructions);
+                instructions.append(forLoopInstructions)
+                        .append(codeInstructions);
+                break;
+            }
+            default:
+                break;
         }
 
         scopedVariables->popVariableScope(tempVars);
@@ -247,14 +306,14 @@ SimpleResolution *AbstractAssembler::assembleCondition(Condition &condition, Ins
     if (rhsResolution->type == CONSTANT || lhsResolution->type == CONSTANT) {
         bool rhsFlag = rhsResolution->type == CONSTANT;
 
-        NumberValue &constantValue = dynamic_cast<NumberValue &>(rhsFlag ? condition.rhs : condition.lhs);
+        NumberValue &constantValue = static_cast<NumberValue &>(rhsFlag ? condition.rhs : condition.lhs);
         bool negative = constantValue.value < 0;
         long long valCopy = llabs(constantValue.value);
 
         if (valCopy < 10) {
             if (rhsFlag) {
                 instructions.append(lhsResolution->instructions)
-                        .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(lhsResolution->address)));
+                        .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(lhsResolution->address)) : static_cast<Instruction *>(new Load(lhsResolution->address)));
                 while (valCopy-- > 0) {
                     instructions.append(negative ? static_cast<Instruction *>(new Inc()) : static_cast<Instruction *>(new Dec()));
                 }
@@ -262,7 +321,7 @@ SimpleResolution *AbstractAssembler::assembleCondition(Condition &condition, Ins
             } else if (condition.type == EQUAL || condition.type == NOT_EQUAL) {
                 incResolved = true;
                 instructions.append(rhsResolution->instructions)
-                        .append(rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(rhsResolution->address)));
+                        .append(rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(rhsResolution->address)) : static_cast<Instruction *>(new Load(rhsResolution->address)));
                 while (valCopy-- > 0) {
                     instructions.append(negative ? static_cast<Instruction *>(new Inc()) : static_cast<Instruction *>(new Dec()));
                 }
@@ -276,15 +335,15 @@ SimpleResolution *AbstractAssembler::assembleCondition(Condition &condition, Ins
             Sub *sub = new Sub(expressionAccumulator);
 
             instructions.append(rhsResolution->instructions)
-                    .append(rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(rhsResolution->address)))
+                    .append(rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(rhsResolution->address)) : static_cast<Instruction *>(new Load(rhsResolution->address)))
                     .append(store)
                     .append(lhsResolution->instructions)
-                    .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(lhsResolution->address)))
+                    .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(lhsResolution->address)) : static_cast<Instruction *>(new Load(lhsResolution->address)))
                     .append(sub);
         } else {
             Sub *sub = new Sub(rhsResolution->address);
             instructions.append(lhsResolution->instructions)
-                    .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(lhsResolution->address)))
+                    .append(lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(lhsResolution->address)) : static_cast<Instruction *>(new Load(lhsResolution->address)))
                     .append(sub);
         }
     }
@@ -341,18 +400,19 @@ SimpleResolution *AbstractAssembler::assembleCondition(Condition &condition, Ins
 }
 
 SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expression) {
-    try {
-        UnaryExpression &unaryExpression = dynamic_cast<UnaryExpression &>(expression);
-        Resolution *valueResolution = resolve(unaryExpression.value);
-        if (valueResolution->indirect) {
-            valueResolution->instructions.append(new Loadi(primaryAccumulator));
-        } else {
-            valueResolution->instructions.append(new Load(valueResolution->address));
+    switch (expression.kind) {
+        case UNARY_EXPRESSION_NODE: {
+            UnaryExpression &unaryExpression = static_cast<UnaryExpression &>(expression);
+            Resolution *valueResolution = resolve(unaryExpression.value);
+            if (valueResolution->indirect) {
+                valueResolution->instructions.append(new Loadi(valueResolution->address));
+            } else {
+                valueResolution->instructions.append(new Load(valueResolution->address));
+            }
+            return new SimpleResolution(valueResolution->instructions, valueResolution->temporaryVars);
         }
-        return new SimpleResolution(valueResolution->instructions, valueResolution->temporaryVars);
-    } catch (std::bad_cast e) {
-        try {
-            BinaryExpression &binaryExpression = dynamic_cast<BinaryExpression &>(expression);
+        case BINARY_EXPRESSION_NODE: {
+            BinaryExpression &binaryExpression = static_cast<BinaryExpression &>(expression);
             InstructionList &instructionList = *new InstructionList();
 
             long long tempVars = 0;
@@ -360,15 +420,15 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
             Resolution *lhsResolution = resolve(binaryExpression.lhs);
             Resolution *rhsResolution = resolve(binaryExpression.rhs);
 
-            Instruction *lhsLoad = lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(lhsResolution->address));
-            Instruction *rhsLoad = rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(rhsResolution->address));
+            Instruction *lhsLoad = lhsResolution->indirect ? static_cast<Instruction *>(new Loadi(lhsResolution->address)) : static_cast<Instruction *>(new Load(lhsResolution->address));
+            Instruction *rhsLoad = rhsResolution->indirect ? static_cast<Instruction *>(new Loadi(rhsResolution->address)) : static_cast<Instruction *>(new Load(rhsResolution->address));
 
             bool modulo = false;
             switch (binaryExpression.type) {
                 case ADDITION: {
                     bool incResolved = false;
                     if (rhsResolution->type == CONSTANT || lhsResolution->type == CONSTANT) {
-                        NumberValue &constantValue = dynamic_cast<NumberValue &>(rhsResolution->type == CONSTANT ? binaryExpression.rhs : binaryExpression.lhs);
+                        NumberValue &constantValue = static_cast<NumberValue &>(rhsResolution->type == CONSTANT ? binaryExpression.rhs : binaryExpression.lhs);
 
                         if (llabs(constantValue.value) < 10) {
                             incResolved = true;
@@ -414,7 +474,7 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                 case SUBTRACTION: {
                     bool incResolved = false;
                     if (rhsResolution->type == CONSTANT) {
-                        NumberValue &constantValue = dynamic_cast<NumberValue &>(binaryExpression.rhs);
+                        NumberValue &constantValue = static_cast<NumberValue &>(binaryExpression.rhs);
 
                         if (llabs(constantValue.value) < 10) {
                             incResolved = true;
@@ -438,7 +498,7 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     if (incResolved) break;
 
                     if (rhsResolution->indirect) {
-                        Sub *sub = new Sub(expressionAccumulator);
+                        Sub *sub = new Sub(secondaryAccumulator);
                         Store *storeRight = new Store(secondaryAccumulator);
 
                         instructionList.append(rhsResolution->instructions)
@@ -460,13 +520,20 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     modulo = true;
                 case DIVISION: {
                     bool incResolved = false;
-                    if (rhsResolution->address.getAddress() == lhsResolution->address.getAddress()) { // if they are the same thing, return 1 or -1
+                    bool computedAddress = &lhsResolution->address == &primaryAccumulator || &rhsResolution->address == &primaryAccumulator; // a[b], a[c] may differ
+
+                    // fused with a division of the same values into the other result (see ASTOptimizer::fuseDivisions)
+                    Resolution *companionResolution = binaryExpression.companion ? resolve(*binaryExpression.companion, false) : nullptr;
+
+                    // a fused one always runs the loop below, as only the loop yields both results
+                    if (!companionResolution && !computedAddress && lhsResolution->indirect == rhsResolution->indirect
+                        && rhsResolution->address.getAddress() == lhsResolution->address.getAddress()) { // if they are the same thing, return 1 or -1
                         incResolved = true;
                         if (modulo) {
                             instructionList.append(new Sub(primaryAccumulator));
                         } else {
                             if (rhsResolution->type == CONSTANT) {
-                                NumberValue &numberValue = dynamic_cast<NumberValue &>(binaryExpression.rhs);
+                                NumberValue &numberValue = static_cast<NumberValue &>(binaryExpression.rhs);
 
                                 instructionList.append(new Sub(primaryAccumulator));
                                 if (numberValue.value > 0) {
@@ -487,10 +554,10 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                                         .append(resetAccToZero);
                             }
                         }
-                    } else if (rhsResolution->type == CONSTANT || lhsResolution->type == CONSTANT) { // know constants optimization
+                    } else if (!companionResolution && (rhsResolution->type == CONSTANT || lhsResolution->type == CONSTANT)) { // know constants optimization
                         bool rhsFlag = rhsResolution->type == CONSTANT;
 
-                        NumberValue &constantValue = dynamic_cast<NumberValue &>(rhsFlag ? binaryExpression.rhs : binaryExpression.lhs);
+                        NumberValue &constantValue = static_cast<NumberValue &>(rhsFlag ? binaryExpression.rhs : binaryExpression.lhs);
                         bool negative = constantValue.value < 0;
                         long long valCopy = llabs(constantValue.value);
 
@@ -525,6 +592,13 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                                             .append(new Inc())
                                             .append(new Inc());
                                 }
+                            } else if (negative) { // a div -2 = floor(-a / 2), the shift rounding down
+                                instructionList.append(lhsResolution->instructions)
+                                        .append(lhsLoad)
+                                        .append(new Store(expressionAccumulator))
+                                        .append(new Sub(expressionAccumulator))
+                                        .append(new Sub(expressionAccumulator))
+                                        .append(new Shift(constants->getConstant(-1)->getAddress()));
                             } else { // a div 2
                                 InstructionList &positiveABlock = *new InstructionList();
                                 positiveABlock.append(new Shift(constants->getConstant(-1)->getAddress()))
@@ -561,12 +635,12 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     if (incResolved) break;
 
 
-                    TemporaryVariable *scaledDivisor = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *sign = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *divisor = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *dividend = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *multiple = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *remain = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
+                    TemporaryVariable *scaledDivisor = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *sign = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *divisor = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *dividend = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *multiple = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *remain = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
                     scopedVariables->pushVariableScope(scaledDivisor);
                     scopedVariables->pushVariableScope(sign);
                     scopedVariables->pushVariableScope(divisor);
@@ -607,72 +681,86 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                             .append(new Load(multiple->getAddress()))
                             .append(new Shift(constants->getConstant(-1)->getAddress()));
 
-                    InstructionList &loadResultBlock = *new InstructionList();
-                    if (modulo) {
-                        loadResultBlock.append(new Load(remain->getAddress()))
-                                .append(new Jzero(instructionList.end()))
-                                .append(new Load(sign->getAddress()));
-
-                        InstructionList &negativeSignBlock = *new InstructionList();
-                        negativeSignBlock.append(new Load(divisor->getAddress()))
-                                .append(new Jzero(instructionList.end()));
-
-                        InstructionList &aNegative = *new InstructionList();
-                        aNegative.append(new Sub(remain->getAddress()))
-                                .append(new Jump(zeroResultBlock.end()));
-
-                        InstructionList &bNegative = *new InstructionList();
-                        bNegative.append(new Add(remain->getAddress()))
-                                .append(new Jump(zeroResultBlock.end()));
-
-                        negativeSignBlock.append(new Jpos(bNegative.end()))
-                                .append(bNegative)
-                                .append(aNegative);
-
-                        InstructionList &positiveSignBlock = *new InstructionList();
-                        positiveSignBlock.append(new Load(divisor->getAddress()))
-                                .append(new Jzero(instructionList.end()));
-
-                        InstructionList &bothNegativeBlock = *new InstructionList();
-                        bothNegativeBlock.append(new Sub(primaryAccumulator))
-                                .append(new Sub(remain->getAddress()))
-                                .append(new Jump(zeroResultBlock.end()));
-
-                        InstructionList &bothPositiveBlock = *new InstructionList();
-                        bothPositiveBlock.append(new Load(remain->getAddress()))
-                                .append(new Jump(zeroResultBlock.end()));
-
-                        positiveSignBlock.append(new Jpos(bothPositiveBlock.start()))
-                                .append(bothNegativeBlock)
-                                .append(bothPositiveBlock);
-
-                        loadResultBlock.append(new Jzero(negativeSignBlock.end()))
-                                .append(negativeSignBlock)
-                                .append(positiveSignBlock);
-                    } else {
-                        loadResultBlock.append(new Load(sign->getAddress()));
-
-                        InstructionList &negativeResultBlock = *new InstructionList();
-                        negativeResultBlock.append(new Load(remain->getAddress()));
-
-                        InstructionList &remainBlock = *new InstructionList();
-                        remainBlock.append(new Sub(primaryAccumulator))
-                                .append(new Sub(expressionAccumulator))
-                                .append(new Dec())
-                                .append(new Jump(zeroResultBlock.end()));
+                    // loads the quotient or the remainder, with the signs fixed, and jumps to done
+                    auto loadResult = [&](bool remainder, Instruction *done) -> InstructionList & {
+                        InstructionList &resultBlock = *new InstructionList();
+                        if (remainder) {
+                            resultBlock.append(new Load(remain->getAddress()))
+                                    .append(new Jzero(done))
+                                    .append(new Load(sign->getAddress()));
+
+                            InstructionList &negativeSignBlock = *new InstructionList();
+                            negativeSignBlock.append(new Load(divisor->getAddress()))
+                                    .append(new Jzero(done));
+
+                            InstructionList &aNegative = *new InstructionList();
+                            aNegative.append(new Sub(remain->getAddress()))
+                                    .append(new Jump(done));
+
+                            InstructionList &bNegative = *new InstructionList();
+                            bNegative.append(new Add(remain->getAddress()))
+                                    .append(new Jump(done));
+
+                            negativeSignBlock.append(new Jpos(bNegative.end()))
+                                    .append(bNegative)
+                                    .append(aNegative);
+
+                            InstructionList &positiveSignBlock = *new InstructionList();
+                            positiveSignBlock.append(new Load(divisor->getAddress()))
+                                    .append(new Jzero(done));
+
+                            InstructionList &bothNegativeBlock = *new InstructionList();
+                            bothNegativeBlock.append(new Sub(primaryAccumulator))
+                                    .append(new Sub(remain->getAddress()))
+                                    .append(new Jump(done));
+
+                            InstructionList &bothPositiveBlock = *new InstructionList();
+                            bothPositiveBlock.append(new Load(remain->getAddress()))
+                                    .append(new Jump(done));
+
+                            positiveSignBlock.append(new Jpos(bothPositiveBlock.start()))
+                                    .append(bothNegativeBlock)
+                                    .append(bothPositiveBlock);
+
+                            resultBlock.append(new Jzero(negativeSignBlock.end()))
+                                    .append(negativeSignBlock)
+                                    .append(positiveSignBlock);
+                        } else {
+                            resultBlock.append(new Load(sign->getAddress()));
+
+                            InstructionList &negativeResultBlock = *new InstructionList();
+                            negativeResultBlock.append(new Load(remain->getAddress()));
+
+                            InstructionList &remainBlock = *new InstructionList();
+                            remainBlock.append(new Sub(primaryAccumulator))
+                                    .append(new Sub(expressionAccumulator))
+                                    .append(new Dec())
+                                    .append(new Jump(done));
+
+                            negativeResultBlock.append(new Jzero(remainBlock.end()))
+                                    .append(remainBlock)
+                                    .append(new Sub(primaryAccumulator))
+                                    .append(new Sub(expressionAccumulator))
+                                    .append(new Jump(done));
+
+                            resultBlock.append(new Jzero(negativeResultBlock.end()))
+                                    .append(negativeResultBlock)
+                                    .append(new Load(expressionAccumulator))
+                                    .append(new Jump(done));
+                        }
 
-                        negativeResultBlock.append(new Jzero(remainBlock.end()))
-                                .append(remainBlock)
-                                .append(new Sub(primaryAccumulator))
-                                .append(new Sub(expressionAccumulator))
-                                .append(new Jump(zeroResultBlock.end()));
+                        return resultBlock;
+                    };
 
-                        loadResultBlock.append(new Jzero(negativeResultBlock.end()))
-                                .append(negativeResultBlock)
-                                .append(new Load(expressionAccumulator))
-                                .append(new Jump(zeroResultBlock.end()));
+                    // a fused division stores the other result to the companion first
+                    InstructionList &storeCompanionBlock = *new InstructionList();
+                    if (companionResolution) {
+                        storeCompanionBlock.append(new Store(companionResolution->address));
+                        zeroResultBlock.append(new Store(companionResolution->address));
                     }
 
+                    InstructionList &loadResultBlock = companionResolution ? loadResult(!modulo, storeCompanionBlock.start()) : loadResult(modulo, zeroResultBlock.end());
+
                     afterIfBlock.append(new Jzero(loadResultBlock.start()))
                             .append(new Store(multiple->getAddress()));
                     doWhileBlock.append(new Jneg(afterIfBlock.start()));
@@ -763,59 +851,55 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     instructionList.append(initBlock)
                             .append(firstWhileBlock)
                             .append(doWhileBlock)
-                            .append(loadResultBlock)
-                            .append(zeroResultBlock);
+                            .append(loadResultBlock);
+                    if (companionResolution) {
+                        instructionList.append(storeCompanionBlock)
+                                .append(loadResult(modulo, zeroResultBlock.end()));
+                    }
+                    instructionList.append(zeroResultBlock);
                 }
                     break;
                 case MULTIPLICATION: { // A * B
-                    bool incResolved = false;
                     if (rhsResolution->type == CONSTANT || lhsResolution->type == CONSTANT) { // know constants optimization
                         bool rhsFlag = rhsResolution->type == CONSTANT;
 
-                        NumberValue &constantValue = dynamic_cast<NumberValue &>(rhsFlag ? binaryExpression.rhs : binaryExpression.lhs);
-                        bool negative = constantValue.value < 0;
-                        long long valCopy = llabs(constantValue.value);
+                        long long multiplier = static_cast<NumberValue &>(rhsFlag ? binaryExpression.rhs : binaryExpression.lhs).value;
+                        Resolution *operand = rhsFlag ? lhsResolution : rhsResolution;
 
-                        if (valCopy && (valCopy & (valCopy - 1)) == 0) { // 2^n
-                            incResolved = true;
-
-                            long long power = 0;
-                            while (valCopy = valCopy >> 1) power++;
-
-                            constants->addConstant(power);
-
-                            instructionList.append(rhsFlag ? lhsResolution->instructions : rhsResolution->instructions)
-                                    .append(rhsFlag ? lhsLoad : rhsLoad)
-                                    .append(new Shift(constants->getConstant(power)->getAddress()));
+                        if (multiplier == 0) { // just 0 lol
+                            instructionList.append(new Sub(primaryAccumulator));
+                            break;
+                        }
 
-                            if (negative) {
-                                instructionList.append(new Store(expressionAccumulator))
-                                        .append(new Sub(expressionAccumulator))
-                                        .append(new Sub(expressionAccumulator));
-                            }
-                        } else if (valCopy == 1) { // 1, -1
-                            instructionList.append(rhsFlag ? lhsResolution->instructions : rhsResolution->instructions)
-                                    .append(rhsFlag ? lhsLoad : rhsLoad);
+                        const MultiplicationPlan &plan = multiplications.plan(multiplier);
+
+                        // the steps add and subtract x itself, which needs a direct address
+                        ResolvableAddress *operandAddress = &operand->address;
+                        instructionList.append(operand->instructions);
+                        if (operand->indirect && (plan.usesOperand() || plan.negative)) {
+                            instructionList.append(new Loadi(operand->address))
+                                    .append(new Store(expressionAccumulator));
+                            operandAddress = &expressionAccumulator;
+                        } else if (!plan.negative) {
+                            instructionList.append(rhsFlag ? lhsLoad : rhsLoad);
+                        }
 
-                            if (negative) {
-                                instructionList.append(new Store(expressionAccumulator))
-                                        .append(new Sub(expressionAccumulator))
-                                        .append(new Sub(expressionAccumulator));
-                            }
-                        } else if (valCopy == 0) { // just 0 lol
-                            instructionList.append(new Sub(primaryAccumulator));
+                        if (plan.negative) {
+                            instructionList.append(new Sub(primaryAccumulator))
+                                    .append(new Sub(*operandAddress));
                         }
-                    }
 
-                    if (incResolved) break;
+                        instructionList.append(MultiplicationPlanner::emit(plan, *operandAddress, secondaryAccumulator, constants));
+                        break;
+                    }
 
-                    TemporaryVariable *temporaryA = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *temporaryB = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
+                    TemporaryVariable *temporaryA = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *temporaryB = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
                     scopedVariables->pushVariableScope(temporaryA);
                     scopedVariables->pushVariableScope(temporaryB);
 
-                    TemporaryVariable *copiedA = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
-                    TemporaryVariable *copiedB = new TemporaryVariable(TEMPORARY_NAMES, *new ResolvableAddress());
+                    TemporaryVariable *copiedA = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
+                    TemporaryVariable *copiedB = new TemporaryVariable(temporaryNames, *new ResolvableAddress());
                     scopedVariables->pushVariableScope(copiedA);
                     scopedVariables->pushVariableScope(copiedB);
                     tempVars += 4;
@@ -856,13 +940,13 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     initBlock.append(new Sub(primaryAccumulator))
                             .append(new Store(expressionAccumulator)) // reset result
                             .append(aResolution->instructions)
-                            .append(aResolution->indirect ? static_cast<Instruction * >(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(aResolution->address)))
+                            .append(aResolution->indirect ? static_cast<Instruction *>(new Loadi(aResolution->address)) : static_cast<Instruction *>(new Load(aResolution->address)))
                             .append(new Jzero(loadResultBlock.start())); // skip algorithm, if a was zero
 
                     InstructionList &aLessThanZeroBlock = *new InstructionList();
                     aLessThanZeroBlock.append(new Store(temporaryA->getAddress()))
                             .append(bResolution->instructions)
-                            .append(bResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(bResolution->address)))
+                            .append(bResolution->indirect ? static_cast<Instruction *>(new Loadi(bResolution->address)) : static_cast<Instruction *>(new Load(bResolution->address)))
                             .append(new Jzero(loadResultBlock.start())) // skip algorithm, if b was zero
                             .append(new Store(temporaryB->getAddress())); // save it for now for swaps
 
@@ -912,7 +996,7 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     initBlock.append(new Jneg(aLessThanZeroBlock.start())) // go to negative a block
                             .append(new Store(copiedA->getAddress())) // or just store a
                             .append(newBResolution->instructions)
-                            .append(newBResolution->indirect ? static_cast<Instruction *>(new Loadi(primaryAccumulator)) : static_cast<Instruction *>(new Load(newBResolution->address)))
+                            .append(newBResolution->indirect ? static_cast<Instruction *>(new Loadi(newBResolution->address)) : static_cast<Instruction *>(new Load(newBResolution->address)))
                             .append(new Jzero(loadResultBlock.start())) // skip algorithm, if b = 0
                             .append(new Store(temporaryB->getAddress())); // store in temporary for now, because when a > b, b * a is faster than a * b
 
@@ -958,46 +1042,142 @@ SimpleResolution *AbstractAssembler::assembleExpression(AbstractExpression &expr
                     instructionList,
                     tempVars + lhsResolution->temporaryVars + rhsResolution->temporaryVars
             );
-        } catch (std::bad_cast
-                 ee) {}
+        }
+        default:
+            throw "Expression resolution error";
+    }
+}
+
+void AbstractAssembler::countArrayAccesses(Node *node, Symbol index, std::vector<std::pair<Symbol, double>> &accesses, double frequency) {
+    switch (node->kind) {
+        case VARIABLE_ACCESS_IDENTIFIER_NODE: {
+            auto varAccId = static_cast<VariableAccessIdentifier *>(node);
+            if (varAccId->accessName != index) break;
+
+            auto access = std::find_if(accesses.begin(), accesses.end(), [varAccId](const std::pair<Symbol, double> &access) { return access.first == varAccId->name; });
+            if (access == accesses.end()) {
+                accesses.emplace_back(varAccId->name, frequency);
+            } else {
+                access->second += frequency;
+            }
+            break;
+        }
+        case IDENTIFIER_VALUE_NODE:
+            countArrayAccesses(&static_cast<IdentifierValue *>(node)->identifier, index, accesses, frequency);
+            break;
+        case UNARY_EXPRESSION_NODE:
+            countArrayAccesses(&static_cast<UnaryExpression *>(node)->value, index, accesses, frequency);
+            break;
+        case BINARY_EXPRESSION_NODE:
+            countArrayAccesses(&static_cast<BinaryExpression *>(node)->lhs, index, accesses, frequency);
+            countArrayAccesses(&static_cast<BinaryExpression *>(node)->rhs, index, accesses, frequency);
+            break;
+        case CONDITION_NODE:
+            countArrayAccesses(&static_cast<Condition *>(node)->lhs, index, accesses, frequency);
+            countArrayAccesses(&static_cast<Condition *>(node)->rhs, index, accesses, frequency);
+            break;
+        case COMMAND_LIST_NODE:
+            for (auto const &command : static_cast<CommandList *>(node)->commands) countArrayAccesses(command, index, accesses, frequency);
+            break;
+        case ASSIGNMENT_NODE:
+            countArrayAccesses(&static_cast<Assignment *>(node)->identifier, index, accesses, frequency);
+            countArrayAccesses(&static_cast<Assignment *>(node)->expression, index, accesses, frequency);
+            break;
+        case READ_NODE:
+            countArrayAccesses(&static_cast<Read *>(node)->identifier, index, accesses, frequency);
+            break;
+        case WRITE_NODE:
+            countArrayAccesses(&static_cast<Write *>(node)->value, index, accesses, frequency);
+            break;
+        case IF_NODE:
+            countArrayAccesses(&static_cast<If *>(node)->condition, index, accesses, frequency);
+            countArrayAccesses(&static_cast<If *>(node)->commands, index, accesses, frequency / 2);
+            break;
+        case IF_ELSE_NODE:
+            countArrayAccesses(&static_cast<IfElse *>(node)->condition, index, accesses, frequency);
+            countArrayAccesses(&static_cast<IfElse *>(node)->commands, index, accesses, frequency / 2);
+            countArrayAccesses(&static_cast<IfElse *>(node)->elseCommands, index, accesses, frequency / 2);
+            break;
+        case WHILE_NODE:
+            countArrayAccesses(&static_cast<While *>(node)->condition, index, accesses, frequency);
+            countArrayAccesses(&static_cast<While *>(node)->commands, index, accesses, frequency);
+            break;
+        case FOR_NODE:
+            countArrayAccesses(&static_cast<For *>(node)->startValue, index, accesses, frequency);
+            countArrayAccesses(&static_cast<For *>(node)->endValue, index, accesses, frequency);
+            countArrayAccesses(&static_cast<For *>(node)->commands, index, accesses, frequency);
+            break;
+        default:
+            break;
+    }
+}
+
+void AbstractAssembler::planMultiplications(Node *node) {
+    switch (node->kind) {
+        case BINARY_EXPRESSION_NODE: {
+            auto binaryExpression = static_cast<BinaryExpression *>(node);
+            if (binaryExpression->type != MULTIPLICATION) break;
+
+            // the same operand as in assembleExpression is taken for the multiplier
+            AbstractValue *multiplier = binaryExpression->rhs.kind == NUMBER_VALUE_NODE ? &binaryExpression->rhs : &binaryExpression->lhs;
+            if (multiplier->kind != NUMBER_VALUE_NODE || !static_cast<NumberValue *>(multiplier)->value) break;
+
+            for (const auto shift : multiplications.plan(static_cast<NumberValue *>(multiplier)->value).shifts()) {
+                program.constants.add(shift);
+            }
+            break;
+        }
+        case COMMAND_LIST_NODE:
+            for (auto const &command : static_cast<CommandList *>(node)->commands) planMultiplications(command);
+            break;
+        case ASSIGNMENT_NODE:
+            planMultiplications(&static_cast<Assignment *>(node)->expression);
+            break;
+        case IF_NODE:
+            planMultiplications(&static_cast<If *>(node)->commands);
+            break;
+        case IF_ELSE_NODE:
+            planMultiplications(&static_cast<IfElse *>(node)->commands);
+            planMultiplications(&static_cast<IfElse *>(node)->elseCommands);
+            break;
+        case WHILE_NODE:
+            planMultiplications(&static_cast<While *>(node)->commands);
+            break;
+        case FOR_NODE:
+            planMultiplications(&static_cast<For *>(node)->commands);
+            break;
+        default:
+            break;
     }
 }
 
 Resolution *AbstractAssembler::resolve(AbstractIdentifier &identifier, bool checkInit = true) {
     Variable *var = scopedVariables->resolveVariable(identifier.name);
     if (checkInit && !var->initialized) {
-        std::cout << "   [w] Variable " << var->name << " may not have been initialized" << std::endl;
-        warning = true;
+        Diagnostics::warn("Variable " + Symbols::name(var->name) + " may not have been initialized");
     }
     var->initialized = true; // assume it was initialized at this point
 
-    if (auto numVar = dynamic_cast<NumberVariable *>(var)) {
-        try {
-            VariableIdentifier &varId = dynamic_cast<VariableIdentifier &>(identifier); // check if the identifier was actually a var id
+    if (auto numVar = var->as<NumberVariable>()) {
+        if (identifier.kind != VARIABLE_IDENTIFIER_NODE) throw "Trying to access a number variable like an array";
 
-            return new Resolution(
-                    *new InstructionList(),
-                    numVar->getAddress(),
-                    VARIABLE,
-                    false,
-                    0, // zero temp vars used
-                    !numVar->readOnly // if it's readOnly, it's not writable -- used for iterators
-            );
-        } catch (std::bad_cast _) {
-            throw "Trying to access a number variable like an array";
-        }
-    } else if (auto arrayVar = dynamic_cast<NumberArrayVariable *>(var)) {
-        try { // ACCESS VALUE - a[0]
-            AccessIdentifier &accId = dynamic_cast<AccessIdentifier &>(identifier);
-
-            if ((accId.index < arrayVar->start || accId.index > arrayVar->end) && !arrayVar->warned) {
-                std::cout << "   [w] Trying to access " + arrayVar->toString() + " at index " + std::to_string(accId.index) << "; you won't be warned about this array anymore" << std::endl;
-                warning = true;
+        return new Resolution(
+                *new InstructionList(),
+                numVar->getAddress(),
+                VARIABLE,
+                false,
+                0, // zero temp vars used
+                !numVar->readOnly // if it's readOnly, it's not writable -- used for iterators
+        );
+    } else if (auto arrayVar = var->as<NumberArrayVariable>()) {
+        if (auto accId = identifier.as<AccessIdentifier>()) { // ACCESS VALUE - a[0]
+            if ((accId->index < arrayVar->start || accId->index > arrayVar->end) && !arrayVar->warned) {
+                Diagnostics::warn("Trying to access " + arrayVar->toString() + " at index " + std::to_string(accId->index) + "; you won't be warned about this array anymore");
                 arrayVar->warned = true;
             }
 
             ResolvableAddress &address = *new ResolvableAddress(arrayVar->getAddress().getAddress()); // copy address
-            address.setOffset(accId.index - arrayVar->start); // set proper offset
+            address.setOffset(accId->index - arrayVar->start); // set proper offset
 
             return new Resolution(
                     *new InstructionList(),
@@ -1005,69 +1185,89 @@ Resolution *AbstractAssembler::resolve(AbstractIdentifier &identifier, bool chec
                     CONSTANT_ARRAY,
                     false
             );
-        } catch (std::bad_cast _) {
-            try { // VARIABLE ACCESS VALUE - a[b]
-                VariableAccessIdentifier &varAccId = dynamic_cast<VariableAccessIdentifier &>(identifier);
-
-                ResolvableAddress &startValueAddress = constants->getConstant(arrayVar->start)->getAddress(); // arr start
-                Variable *variable = scopedVariables->resolveVariable(varAccId.accessName); // "b" variable
-                if (!variable->initialized) {
-                    std::cout << "   [w] Variable " << variable->name << " may not have been initialized" << std::endl;
-                    warning = true;
+        } else if (auto varAccId = identifier.as<VariableAccessIdentifier>()) { // VARIABLE ACCESS VALUE - a[b]
+            for (auto pointer = derivedPointers.rbegin(); pointer != derivedPointers.rend(); pointer++) {
+                if (pointer->array == varAccId->name && pointer->index == varAccId->accessName) {
+                    return new Resolution(
+                            *new InstructionList(),
+                            pointer->pointer->getAddress(), // holds the address already
+                            VARIABLE_ARRAY,
+                            true
+                    );
                 }
-                variable->initialized = true; // assume it was initialized at this point
+            }
 
-                ResolvableAddress &arrAddressAddress = constants->getConstant(arrayVar->getAddress().getAddress())->getAddress();
+            ResolvableAddress &startValueAddress = constants->getConstant(arrayVar->start)->getAddress(); // arr start
+            Variable *variable = scopedVariables->resolveVariable(varAccId->accessName); // "b" variable
+            if (!variable->initialized) {
+                Diagnostics::warn("Variable " + Symbols::name(variable->name) + " may not have been initialized");
+            }
+            variable->initialized = true; // assume it was initialized at this point
 
-                InstructionList &instructionList = *new InstructionList();
+            ResolvableAddress &arrAddressAddress = constants->getConstant(arrayVar->getAddress().getAddress())->getAddress();
 
-                Load *load = new Load(variable->getAddress()); // load value of b
-                Sub *sub = new Sub(startValueAddress); // subtract value of starting index
-                Add *add = new Add(arrAddressAddress); // add value of array address
+            InstructionList &instructionList = *new InstructionList();
 
-                instructionList.append(load)
-                        .append(sub)
-                        .append(add);
+            Load *load = new Load(variable->getAddress()); // load value of b
+            Sub *sub = new Sub(startValueAddress); // subtract value of starting index
+            Add *add = new Add(arrAddressAddress); // add value of array address
 
-                return new Resolution(
-                        instructionList,
-                        *new ResolvableAddress(),
-                        VARIABLE_ARRAY,
-                        true
-                );
-            } catch (std::bad_cast __) {
-                throw "Trying to use array identifier as variable";
-            }
-        }
+            instructionList.append(load)
+                    .append(sub)
+                    .append(add);
+
+            return new Resolution(
+                    instructionList,
+                    primaryAccumulator, // the address ends up in the accumulator
+                    VARIABLE_ARRAY,
+                    true
+            );
+        } else throw "Trying to use array identifier as variable";
     } else throw "Variable resolution error";
 }
 
 Resolution *AbstractAssembler::resolve(AbstractValue &value) {
-    try { // NUMBER VALUE - 0
-        NumberValue &numberValue = dynamic_cast<NumberValue &>(value);
-        ResolvableAddress &address = constants->getConstant(numberValue.value)->getAddress();
-        return new Resolution(
-                *new InstructionList(),
-                address,
-                CONSTANT,
-                false,
-                0
-        );
-    } catch (std::bad_cast _) {
-        try {
-            IdentifierValue &identifierValue = dynamic_cast<IdentifierValue &>(value);
-            return resolve(identifierValue.identifier);
-        } catch (std::bad_cast __) {
-            throw "Value resolution error";
+    switch (value.kind) {
+        case NUMBER_VALUE_NODE: { // NUMBER VALUE - 0
+            ResolvableAddress &address = constants->getConstant(static_cast<NumberValue &>(value).value)->getAddress();
+            return new Resolution(
+                    *new InstructionList(),
+                    address,
+                    CONSTANT,
+                    false,
+                    0
+            );
         }
+        case IDENTIFIER_VALUE_NODE:
+            return resolve(static_cast<IdentifierValue &>(value).identifier);
+        default:
+            throw "Value resolution error";
     }
 }
 
 InstructionList &AbstractAssembler::assemble(bool verbose) {
-    getVariablesFromDeclarations(verbose);
-    prepareConstants(verbose);
-    SimpleResolution *programCodeResolution = assembleCommands(program.commands);
-    removeUselessConstants(programCodeResolution->instructions);
+    Phase phase("assemble");
+
+    {
+        Phase declarationsPhase("declarations");
+        planMultiplications(&program.commands);
+        getVariablesFromDeclarations(verbose);
+        prepareConstants(verbose);
+    }
+
+    SimpleResolution *programCodeResolution;
+    {
+        Phase commandsPhase("commands");
+        programCodeResolution = assembleCommands(program.commands);
+    }
+
+    {
+        Phase removalPhase("useless constants removal");
+        removeUselessConstants(programCodeResolution->instructions);
+    }
+    Stats::set("constants", constants->getConstants().size());
+
+    Phase constantsPhase("constants");
     InstructionList &instructions = assembleConstants();
     instructions.append(programCodeResolution->instructions);
     instructions.seal(true);
@@ -3,11 +3,17 @@
 #include "../../back/asm/InstructionList.h"
 #include "ScopedVariables.h"
 #include "Constants.h"
+#include "Multiplication.h"
+#include "ConstantPlanner.h"
+#include "../../driver/Diagnostics.h"
+#include "../../driver/Stats.h"
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <typeinfo>
 #include <cstdlib>
+#include <unordered_set>
+#include <algorithm>
 
 #ifndef COMPILER_ABSTRACTASSEMBLER_H
 #define COMPILER_ABSTRACTASSEMBLER_H
@@ -26,7 +32,7 @@ enum ResolutionType {
  * variable can be modified (writable) and what it really is
  * (important with constants).
  */
-class Resolution {
+class Resolution : public ArenaObject {
 public:
     bool writable;
     bool indirect;
@@ -43,7 +49,7 @@ public:
  * A result of something that produces results in accumulator
  * e.g. expressions.
  */
-class SimpleResolution {
+class SimpleResolution : public ArenaObject {
 public:
     long long temporaryVars;
     InstructionList &instructions;
@@ -51,6 +57,16 @@ public:
     SimpleResolution(InstructionList &instructionList, long long temporaryVar) : instructions(instructionList), temporaryVars(temporaryVar) {}
 };
 
+/**
+ * A temporary holding the address of a[i] for the iterator i of an
+ * enclosing for loop; it is moved along with the iterator.
+ */
+struct DerivedPointer {
+    Symbol array;
+    Symbol index;
+    Variable *pointer;
+};
+
 /**
  * A main, monolithic compiler class transforming AST into asm instruction
  * objects list.
@@ -72,8 +88,41 @@ private:
     ResolvableAddress &expressionAccumulator = *new ResolvableAddress(2); // used to remember loaded value
 
     Program &program;
-    ScopedVariables *scopedVariables;
-    Constants *constants;
+
+    /**
+     * Name of every temporary; the lexer never produces a "!", so it
+     * can't clash with user variables. It's interned into the symbols
+     * active when the assembler is created, i.e. the program's ones.
+     */
+    Symbol temporaryNames = Symbols::intern("!TEMP");
+
+    ScopedVariables *scopedVariables = nullptr;
+    Constants *constants = nullptr;
+
+    /**
+     * Pointers of the for loops being assembled, innermost last.
+     */
+    std::vector<DerivedPointer> derivedPointers;
+
+    MultiplicationPlanner multiplications;
+
+    /**
+     * Plans every multiplication by a constant ahead of assembly, adding
+     * the shift amounts to Program constants so that their addresses are
+     * reserved along with the other constants'.
+     * @param node Node to be searched.
+     */
+    void planMultiplications(Node *node);
+
+    /**
+     * Sums up how often arrays are accessed by a given index per execution
+     * of a node; an access in a branch counts as half of one.
+     * @param node Node to be searched.
+     * @param index Symbol of the index variable.
+     * @param accesses Frequencies of accesses to every array found so far.
+     * @param frequency How often the node itself runs.
+     */
+    void countArrayAccesses(Node *node, Symbol index, std::vector<std::pair<Symbol, double>> &accesses, double frequency);
 
     /**
      * Adds variables declared in Program to scoped variables.
@@ -128,7 +177,9 @@ private:
     /**
      * Resolves a value; that means it returns the value's address
      * or instruction loading value's address into the accumulator
-     * to use LOADI or STOREI on.
+     * to use LOADI or STOREI on. For an indirect resolution the address
+     * is the cell holding the value's address once the instructions ran:
+     * the accumulator, or a derived pointer needing no instructions at all.
      * @param value A value we want to load.
      * @return A resolution object with information needed to load it.
      */
@@ -143,7 +194,22 @@ private:
     Resolution *resolve(AbstractIdentifier &identifier, bool checkInit);
 
 public:
-    AbstractAssembler(Program &program) : program(program) {}
+    AbstractAssembler(Program &program) : program(program), multiplications([&program](long long value) {
+        return value == 1 || value == -1 || program.constants.contains(value);
+    }) {}
+
+    AbstractAssembler(const AbstractAssembler &) = delete;
+
+    AbstractAssembler &operator=(const AbstractAssembler &) = delete;
+
+    /**
+     * Instructions, addresses and variables are left in the Program's
+     * arena; only the symbol and constant tables are released here.
+     */
+    ~AbstractAssembler() {
+        delete scopedVariables;
+        delete constants;
+    }
 
     /**
      * Single-click assembly!
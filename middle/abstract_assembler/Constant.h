@@ -19,22 +19,14 @@ class Constants;
 /**
  * A single constant used in program.
  */
-class Constant {
+class Constant : public ArenaObject {
 private:
     ResolvableAddress &address;
 public:
     long long value;
-    long long generationCost;
-    std::string binaryString;
 
     ResolvableAddress &getAddress();
 
-    /**
-     * Generates a code to create the constant and store it in memory
-     * on the assigned address.
-     */
-    InstructionList &generateConstant(Constants *constantsData, ResolvableAddress &primaryAccumulator, ResolvableAddress &secondaryAccumulator);
-
     std::string toString();
 
     Constant(long long value, ResolvableAddress &address);
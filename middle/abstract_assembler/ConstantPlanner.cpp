@@ -0,0 +1,281 @@
+#include "ConstantPlanner.h"
+
+const long long SUB_COST = 10;
+const long long LOAD_COST = 10;
+const long long ADD_COST = 10;
+const long long SHIFT_COST = 5;
+const long long INC_COST = 1;
+
+/**
+ * Longest run of INCs/DECs considered; anything longer is beaten by
+ * appending digits anyway.
+ */
+const long long MAX_DELTA = 1 << 20;
+
+ConstantPlanner::ConstantPlanner(Constants *constants, ResolvableAddress &primaryAccumulator)
+        : constants(constants), primaryAccumulator(primaryAccumulator) {
+    add(constants->getConstant(1));
+    add(constants->getConstant(-1));
+}
+
+Constant *ConstantPlanner::find(long long value) {
+    auto found = generated.find(value);
+    return found == generated.end() ? nullptr : found->second;
+}
+
+void ConstantPlanner::updateShifts(long long *cost, long long *amount, long long sign) {
+    std::vector<long long> available;
+    for (long long shift = 1; shift <= MAX_SHIFT; shift++) {
+        if (find(sign * shift)) available.push_back(shift);
+    }
+
+    cost[0] = 0;
+    amount[0] = 0;
+    for (long long positions = 1; positions <= MAX_SHIFT; positions++) {
+        cost[positions] = -1;
+        for (const auto shift : available) {
+            if (shift > positions) break;
+            if (cost[positions] < 0 || SHIFT_COST + cost[positions - shift] < cost[positions]) {
+                cost[positions] = SHIFT_COST + cost[positions - shift];
+                amount[positions] = shift;
+            }
+        }
+    }
+}
+
+void ConstantPlanner::add(Constant *constant) {
+    generated[constant->value] = constant;
+    ordered[constant->value] = constant;
+
+    if (llabs(constant->value) <= MAX_SHIFT && constant->value != 0) { // a new SHIFT amount
+        if (constant->value > 0) {
+            updateShifts(leftShiftCost, leftShiftAmount, 1);
+        } else {
+            updateShifts(rightShiftCost, rightShiftAmount, -1);
+        }
+    }
+}
+
+bool ConstantPlanner::computeNaf(long long value) {
+    if (value > (1LL << 62) || value < -(1LL << 62)) return false; // the top digit could need a 65th bit
+
+    naf.length = 0;
+    for (long long rest = value; rest != 0; rest /= 2) {
+        int digit = 0;
+        if (rest & 1) digit = (rest & 3) == 1 ? 1 : -1; // & works on two's complement, so for negative rests as well
+        naf.digits[naf.length++] = digit;
+        rest -= digit;
+    }
+
+    naf.prefixes[naf.length] = 0;
+    for (int i = naf.length - 1; i >= 0; i--) {
+        naf.prefixes[i] = naf.prefixes[i + 1] * 2 + naf.digits[i];
+    }
+
+    computeTails(naf);
+    return true;
+}
+
+void ConstantPlanner::computeBinary(long long value) {
+    int significant = value < 0 ? 64 - __builtin_clzll(~value | 1) : 64 - __builtin_clzll(value | 1);
+    binary.length = std::min(significant + 1, MAX_SHIFT - 1); // the prefix above is 0 or -1
+
+    for (int i = 0; i <= binary.length; i++) {
+        binary.digits[i] = (value >> i) & 1;
+        binary.prefixes[i] = value >> i;
+    }
+
+    computeTails(binary);
+}
+
+void ConstantPlanner::computeTails(Digits &digits) {
+    digits.tails[0] = 0;
+
+    int highest = -1; // highest non-zero digit below the position
+    for (int position = 1; position <= digits.length; position++) {
+        if (digits.digits[position - 1]) highest = position - 1;
+
+        if (highest < 0) {
+            digits.tails[position] = leftShiftCost[position];
+        } else {
+            digits.tails[position] = leftShiftCost[position - highest] + INC_COST + digits.tails[highest];
+        }
+    }
+}
+
+void ConstantPlanner::consider(Derivation &best, Derivation candidate) {
+    if (best.cost < 0 || candidate.cost < best.cost) best = candidate;
+}
+
+Derivation ConstantPlanner::plan(long long value) {
+    Derivation best;
+
+    bool withNaf = computeNaf(value);
+    computeBinary(value);
+
+    // the value's prefix from anything, then its digits below the prefix
+    for (const auto representation : {NAF_DIGITS, BINARY_DIGITS}) {
+        if (representation == NAF_DIGITS && !withNaf) continue;
+        Digits &digits = representation == NAF_DIGITS ? naf : binary;
+
+        for (int position = 0; position <= digits.length; position++) {
+            long long prefix = digits.prefixes[position];
+            long long tail = digits.tails[position];
+
+            Derivation candidate;
+            candidate.representation = representation;
+            candidate.position = position;
+
+            __int128 delta = static_cast<__int128>(prefix) - accumulator;
+            if (delta < MAX_DELTA && delta > -MAX_DELTA) {
+                candidate.start = FROM_ACCUMULATOR;
+                candidate.delta = delta;
+                candidate.cost = INC_COST * llabs(candidate.delta) + tail;
+                consider(best, candidate);
+            }
+
+            if (prefix < MAX_DELTA && prefix > -MAX_DELTA) {
+                candidate.start = FROM_ZERO;
+                candidate.delta = prefix;
+                candidate.cost = SUB_COST + INC_COST * llabs(prefix) + tail;
+                consider(best, candidate);
+            }
+
+            candidate.delta = 0;
+            if ((candidate.source = find(prefix))) {
+                candidate.start = FROM_CONSTANT;
+                candidate.cost = LOAD_COST + tail;
+                consider(best, candidate);
+            }
+            if (prefix != LLONG_MIN && (candidate.source = find(-prefix))) {
+                candidate.start = FROM_NEGATED;
+                candidate.cost = SUB_COST + SUB_COST + tail;
+                consider(best, candidate);
+            }
+        }
+    }
+
+    // the closest constants: a few INCs/DECs away, an ADD/SUB away, or sharing the value's top bits
+    std::vector<Constant *> sources = {find(accumulator)};
+    auto above = ordered.lower_bound(value);
+    if (above != ordered.end()) sources.push_back(above->second);
+    if (above != ordered.begin()) sources.push_back(std::prev(above)->second);
+
+    for (const auto &source : sources) {
+        if (!source) continue;
+
+        Derivation candidate;
+        candidate.start = source->value == accumulator ? FROM_ACCUMULATOR : FROM_CONSTANT;
+        candidate.source = source;
+        long long startCost = source->value == accumulator ? 0 : LOAD_COST;
+
+        __int128 difference = static_cast<__int128>(value) - source->value;
+        if (difference < MAX_DELTA && difference > -MAX_DELTA) {
+            candidate.delta = difference;
+            candidate.cost = startCost + INC_COST * llabs(candidate.delta);
+            consider(best, candidate);
+            candidate.delta = 0;
+        }
+
+        if (difference <= LLONG_MAX && difference >= -LLONG_MAX) {
+            if ((candidate.addend = find(difference))) {
+                candidate.subtract = false;
+                candidate.cost = startCost + ADD_COST;
+                consider(best, candidate);
+            }
+            if ((candidate.addend = find(-difference))) {
+                candidate.subtract = true;
+                candidate.cost = startCost + ADD_COST;
+                consider(best, candidate);
+            }
+            candidate.addend = nullptr;
+        }
+
+        unsigned long long differentBits = static_cast<unsigned long long>(source->value ^ value);
+        int lowest = differentBits ? 64 - __builtin_clzll(differentBits) : 0; // shifting by at least this many leaves the value's prefix
+        candidate.representation = BINARY_DIGITS;
+        for (int position = std::max(lowest, 1); position <= binary.length; position++) {
+            candidate.rightShift = position;
+            candidate.position = position;
+            candidate.cost = startCost + rightShiftCost[position] + binary.tails[position];
+            consider(best, candidate);
+        }
+    }
+
+    return best;
+}
+
+void ConstantPlanner::shift(InstructionList &instructions, long long positions, long long *amount, long long sign) {
+    while (positions > 0) {
+        instructions.append(new Shift(find(sign * amount[positions])->getAddress()));
+        positions -= amount[positions];
+    }
+}
+
+void ConstantPlanner::emit(InstructionList &instructions, Derivation &derivation, long long value) {
+    switch (derivation.start) {
+        case FROM_ZERO:
+            instructions.append(new Sub(primaryAccumulator));
+            break;
+        case FROM_ACCUMULATOR:
+            break;
+        case FROM_CONSTANT:
+            instructions.append(new Load(derivation.source->getAddress()));
+            break;
+        case FROM_NEGATED:
+            instructions.append(new Sub(primaryAccumulator))
+                    .append(new Sub(derivation.source->getAddress()));
+            break;
+    }
+
+    if (derivation.addend) {
+        if (derivation.subtract) {
+            instructions.append(new Sub(derivation.addend->getAddress()));
+        } else {
+            instructions.append(new Add(derivation.addend->getAddress()));
+        }
+    }
+
+    shift(instructions, derivation.rightShift, rightShiftAmount, -1);
+
+    for (long long i = 0; i < llabs(derivation.delta); i++) {
+        if (derivation.delta < 0) {
+            instructions.append(new Dec());
+        } else {
+            instructions.append(new Inc());
+        }
+    }
+
+    if (derivation.representation != NO_DIGITS) {
+        Digits &digits = derivation.representation == NAF_DIGITS ? naf : binary;
+
+        long long position = derivation.position;
+        for (long long i = position - 1; i >= 0; i--) {
+            if (!digits.digits[i]) continue;
+
+            shift(instructions, position - i, leftShiftAmount, 1);
+            if (digits.digits[i] > 0) {
+                instructions.append(new Inc());
+            } else {
+                instructions.append(new Dec());
+            }
+            position = i;
+        }
+        shift(instructions, position, leftShiftAmount, 1);
+    }
+
+    instructions.append(new Store(constants->getConstant(value)->getAddress()));
+    accumulator = value;
+}
+
+InstructionList &ConstantPlanner::generate() {
+    InstructionList &instructions = *new InstructionList();
+
+    for (const auto &constant : constants->getConstants()) {
+        Derivation derivation = plan(constant->value);
+        emit(instructions, derivation, constant->value); // the digits of the plan are still there
+        add(constant);
+    }
+
+    return instructions;
+}
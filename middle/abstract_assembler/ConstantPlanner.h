@@ -0,0 +1,133 @@
+#include "Constants.h"
+#include "ResolvableAddress.h"
+#include "../../back/asm/asm.h"
+#include "../../back/asm/InstructionList.h"
+#include <climits>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#ifndef COMPILER_CONSTANTPLANNER_H
+#define COMPILER_CONSTANTPLANNER_H
+
+enum DerivationStart {
+    FROM_ZERO, // SUB 0
+    FROM_ACCUMULATOR, // whatever the previous constant left there
+    FROM_CONSTANT, // LOAD c
+    FROM_NEGATED // SUB 0; SUB c
+};
+
+enum DigitRepresentation {
+    NO_DIGITS,
+    NAF_DIGITS, // non-adjacent form, digits -1, 0 and 1
+    BINARY_DIGITS // two's complement bits
+};
+
+/**
+ * How to compute a constant: take a start value, add or subtract another
+ * constant, shift it right, adjust it with INCs/DECs and then append the
+ * digits of the constant below a position, Horner-like (SHIFT, then INC
+ * or DEC for a non-zero digit).
+ */
+struct Derivation {
+    long long cost = -1;
+
+    DerivationStart start = FROM_ZERO;
+    Constant *source = nullptr;
+
+    Constant *addend = nullptr;
+    bool subtract = false;
+
+    long long rightShift = 0;
+    long long delta = 0;
+
+    DigitRepresentation representation = NO_DIGITS;
+    int position = 0;
+};
+
+/**
+ * Plans the generation of the whole constants pool, picking for each
+ * constant the cheapest derivation (under the vm costs) from the ones
+ * generated before it. Constants are generated in the pool's order, so
+ * small ones, shift amounts among them, come first: a SHIFT by k costs
+ * as much as a SHIFT by 1 once k is there. Every derivation is found with
+ * a constant number of lookups, so huge pools are planned quickly too.
+ */
+class ConstantPlanner {
+private:
+    static const int MAX_SHIFT = 64;
+
+    Constants *constants;
+    ResolvableAddress &primaryAccumulator;
+
+    /**
+     * Constants generated so far (1 and -1 included), by value.
+     */
+    std::unordered_map<long long, Constant *> generated;
+    std::map<long long, Constant *> ordered;
+
+    /**
+     * Value the accumulator holds between the constants.
+     */
+    long long accumulator = -1;
+
+    /**
+     * Cheapest way to shift by a number of positions (left or right)
+     * with the SHIFT amounts generated so far, along with the first
+     * amount to shift by.
+     */
+    long long leftShiftCost[MAX_SHIFT + 1];
+    long long leftShiftAmount[MAX_SHIFT + 1];
+    long long rightShiftCost[MAX_SHIFT + 1];
+    long long rightShiftAmount[MAX_SHIFT + 1];
+
+    void updateShifts(long long *cost, long long *amount, long long sign);
+
+    /**
+     * Digits and prefixes of the constant being planned: digits[i] is the
+     * digit at position i, prefixes[i] the value of the digits at i and
+     * above divided by 2^i, tails[i] the cost of going from prefixes[i]
+     * down to the constant.
+     */
+    struct Digits {
+        int length = 0;
+        int digits[MAX_SHIFT + 1];
+        long long prefixes[MAX_SHIFT + 1];
+        long long tails[MAX_SHIFT + 1];
+    };
+
+    Digits naf;
+    Digits binary;
+
+    bool computeNaf(long long value);
+
+    void computeBinary(long long value);
+
+    void computeTails(Digits &digits);
+
+    Constant *find(long long value);
+
+    void consider(Derivation &best, Derivation candidate);
+
+    Derivation plan(long long value);
+
+    void shift(InstructionList &instructions, long long positions, long long *amount, long long sign);
+
+    void emit(InstructionList &instructions, Derivation &derivation, long long value);
+
+    void add(Constant *constant);
+
+public:
+    /**
+     * @param constants Pool to be planned; 1 and -1 are expected to be
+     * generated already (see Constants::oneAndMinusOne).
+     */
+    ConstantPlanner(Constants *constants, ResolvableAddress &primaryAccumulator);
+
+    /**
+     * @return Instructions generating and storing every other constant.
+     */
+    InstructionList &generate();
+};
+
+#endif //COMPILER_CONSTANTPLANNER_H
@@ -1,5 +1,9 @@
 #include "Constants.h"
 
+bool ConstantOrder::operator()(const Constant *a, const Constant *b) const {
+    return llabs(a->value) < llabs(b->value) || (llabs(a->value) == llabs(b->value) && a->value < b->value);
+}
+
 Constants::Constants(long long int startAddress) : currentAddress(startAddress) {
     one = new Constant(1, *new ResolvableAddress(currentAddress++));
     minusOne = new Constant(-1, *new ResolvableAddress(currentAddress++));
@@ -7,40 +11,19 @@ Constants::Constants(long long int startAddress) : currentAddress(startAddress)
 
 Constant *Constants::addConstant(long long value) {
     if (value == 1 || value == -1) return nullptr;
-
-    for (const auto &constant : constants) {
-        if (constant->value == value) {
-            return nullptr;
-        }
-    }
+    if (index.count(value)) return nullptr;
 
     ResolvableAddress &address = *new ResolvableAddress(currentAddress++); // assign a new address to it
     Constant *constant = new Constant(value, address); // create it with new value
 
-    if (constants.size() == 0) {
-        constants.push_back(constant);
-    } else {
-        for (long long i = 0; i < constants.size(); i++) {
-            if (llabs(constants[i]->value) > llabs(value)) {
-                constants.insert(constants.begin() + i, constant);
-                break;
-            }
-            if (i == constants.size() - 1) {
-                constants.push_back(constant);
-                break;
-            }
-        }
-    }
+    constants.insert(constant);
+    index[value] = constant;
+
     return constant;
 }
 
 void Constants::removeConstant(Constant *constant) {
-    for (long long i = 0; i < constants.size(); i++) {
-        if (constants[i] == constant) {
-            constants.erase(constants.begin() + i);
-            break;
-        }
-    }
+    if (constants.erase(constant)) index.erase(constant->value);
 }
 
 InstructionList &Constants::oneAndMinusOne(ResolvableAddress &primaryAccumulator) {
@@ -59,9 +42,7 @@ Constant *Constants::getConstant(long long value) {
     if (value == 1) return one;
     else if (value == -1) return minusOne;
     else {
-        for (const auto &constant : constants) {
-            if (constant->value == value) return constant;
-        }
-        return nullptr;
+        auto found = index.find(value);
+        return found == index.end() ? nullptr : found->second;
     }
-}
\ No newline at end of file
+}
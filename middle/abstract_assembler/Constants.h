@@ -4,26 +4,46 @@
 class Constant;
 
 #include <algorithm>
+#include <set>
+#include <unordered_map>
 #include "Constant.h"
 
+/**
+ * Orders constants by their absolute values (and then by values
+ * themselves), which is the order they are generated in; a constant
+ * can then be derived from smaller ones generated before it.
+ */
+struct ConstantOrder {
+    bool operator()(const Constant *a, const Constant *b) const;
+};
+
 /**
  * Allows for finding addresses of available constants when compiling.
+ * Constants are kept sorted in generation order and indexed by value,
+ * so adding, finding and removing one are all cheap no matter how many
+ * constants (e.g. from unrolled loops) the program uses.
  */
 class Constants {
 private:
     Constant *one;
     Constant *minusOne;
 
-    std::vector<Constant *> constants;
+    std::set<Constant *, ConstantOrder> constants;
+    std::unordered_map<long long, Constant *> index;
     long long currentAddress;
 public:
+    /**
+     * Adds a new constant, assigning it a new address.
+     * @return The new constant or nullptr if it already existed
+     * (or was 1 or -1, which always exist).
+     */
     Constant *addConstant(long long value);
 
     Constant *getConstant(long long value);
 
     void removeConstant(Constant *constant);
 
-    std::vector<Constant *> getConstants() {
+    const std::set<Constant *, ConstantOrder> &getConstants() {
         return constants;
     }
 
@@ -0,0 +1,112 @@
+#include "Multiplication.h"
+#include <algorithm>
+
+bool MultiplicationPlan::usesOperand() const {
+    return std::any_of(steps.begin(), steps.end(), [](const MultiplicationStep &step) {
+        return step.type == SHIFT_ADD || step.type == SHIFT_SUB;
+    });
+}
+
+std::vector<long long> MultiplicationPlan::shifts() const {
+    std::vector<long long> result;
+    for (const auto &step : steps) {
+        result.push_back(step.shift);
+    }
+    if (finalShift) result.push_back(finalShift);
+    return result;
+}
+
+long long MultiplicationPlanner::costOfShift(long long shift) {
+    return shiftCost + (available(shift) ? 0 : newConstantCost);
+}
+
+const MultiplicationStep &MultiplicationPlanner::find(unsigned long long multiplier) {
+    auto known = best.find(multiplier);
+    if (known != best.end()) return known->second;
+
+    MultiplicationStep step{SHIFT_ADD, 0, 0, 0}; // x * 1 is x itself
+    if (multiplier > 1) {
+        step.cost = -1;
+
+        // x * m = (x * m' << k) +/- x, m' being m -/+ 1 without its trailing zeros
+        for (const auto type : {SHIFT_ADD, SHIFT_SUB}) {
+            unsigned long long even = type == SHIFT_ADD ? multiplier - 1 : multiplier + 1;
+            long long shift = __builtin_ctzll(even);
+            unsigned long long previous = even >> shift;
+
+            long long cost = find(previous).cost + costOfShift(shift) + addCost;
+            if (step.cost < 0 || cost < step.cost) step = {type, previous, shift, cost};
+        }
+
+        // x * m = (x * m' << k) +/- x * m', m being m' * (2^k +/- 1)
+        for (long long shift = 1; shift < 64 && (1ULL << shift) - 1 <= multiplier; shift++) {
+            for (const auto type : {FACTOR_ADD, FACTOR_SUB}) {
+                unsigned long long factor = type == FACTOR_ADD ? (1ULL << shift) + 1 : (1ULL << shift) - 1;
+                if (factor < 3 || factor > multiplier || multiplier % factor) continue;
+
+                unsigned long long previous = multiplier / factor;
+                long long cost = find(previous).cost + storeCost + costOfShift(shift) + addCost;
+                if (cost < step.cost) step = {type, previous, shift, cost};
+            }
+        }
+    }
+
+    return best[multiplier] = step;
+}
+
+const MultiplicationPlan &MultiplicationPlanner::plan(long long multiplier) {
+    auto known = plans.find(multiplier);
+    if (known != plans.end()) return known->second;
+
+    MultiplicationPlan &plan = plans[multiplier];
+    plan.negative = multiplier < 0;
+
+    unsigned long long magnitude = plan.negative ? 0ULL - static_cast<unsigned long long>(multiplier) : multiplier;
+    plan.finalShift = __builtin_ctzll(magnitude);
+
+    for (unsigned long long odd = magnitude >> plan.finalShift; odd > 1;) {
+        const MultiplicationStep &step = find(odd);
+        plan.steps.push_back(step);
+        odd = step.previous;
+    }
+    std::reverse(plan.steps.begin(), plan.steps.end());
+
+    return plan;
+}
+
+InstructionList &MultiplicationPlanner::emit(const MultiplicationPlan &plan, ResolvableAddress &operand, ResolvableAddress &temporary, Constants *constants) {
+    InstructionList &instructions = *new InstructionList();
+
+    auto shift = [&instructions, constants](long long amount) {
+        constants->addConstant(amount); // normally reserved beforehand already
+        instructions.append(new Shift(constants->getConstant(amount)->getAddress()));
+    };
+
+    for (const auto &step : plan.steps) {
+        switch (step.type) {
+            case SHIFT_ADD:
+            case SHIFT_SUB:
+                shift(step.shift);
+                if ((step.type == SHIFT_ADD) != plan.negative) { // the accumulator holds -x * m' for negative plans
+                    instructions.append(new Add(operand));
+                } else {
+                    instructions.append(new Sub(operand));
+                }
+                break;
+            case FACTOR_ADD:
+            case FACTOR_SUB:
+                instructions.append(new Store(temporary));
+                shift(step.shift);
+                if (step.type == FACTOR_ADD) {
+                    instructions.append(new Add(temporary));
+                } else {
+                    instructions.append(new Sub(temporary));
+                }
+                break;
+        }
+    }
+
+    if (plan.finalShift) shift(plan.finalShift);
+
+    return instructions;
+}
@@ -0,0 +1,108 @@
+#include "ResolvableAddress.h"
+#include "Constants.h"
+#include "../../back/asm/asm.h"
+#include "../../back/asm/InstructionList.h"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#ifndef COMPILER_MULTIPLICATION_H
+#define COMPILER_MULTIPLICATION_H
+
+enum MultiplicationStepType {
+    SHIFT_ADD, // acc = acc << k + x
+    SHIFT_SUB, // acc = acc << k - x
+    FACTOR_ADD, // acc = acc << k + acc
+    FACTOR_SUB // acc = acc << k - acc
+};
+
+/**
+ * The last step of computing x * multiplier from x * previous, where
+ * both multipliers are odd and positive.
+ */
+struct MultiplicationStep {
+    MultiplicationStepType type;
+    unsigned long long previous;
+    long long shift;
+
+    /**
+     * Cost of the whole chain from x up to (and including) this step.
+     */
+    long long cost;
+};
+
+/**
+ * A straight line of SHIFTs, ADDs and SUBs multiplying the accumulator
+ * (holding x or -x) by a constant, without the general multiplication's
+ * loop. The steps go from x * 1 up to x * (odd part of the multiplier)
+ * and are followed by a single SHIFT by finalShift.
+ */
+struct MultiplicationPlan {
+    bool negative;
+    std::vector<MultiplicationStep> steps;
+    long long finalShift;
+
+    /**
+     * @return True if some step adds or subtracts x itself, so it has to
+     * be kept in a directly addressable cell.
+     */
+    bool usesOperand() const;
+
+    /**
+     * @return Every shift amount the plan needs as a constant.
+     */
+    std::vector<long long> shifts() const;
+};
+
+/**
+ * Finds the cheapest way (under the vm costs: SHIFT 5, ADD/SUB/STORE 10)
+ * to multiply by a constant. Two decompositions of an odd multiplier m are
+ * searched recursively: m = (m' << k) +/- 1, which covers every signed-digit
+ * form of m, the canonical one included, and m = m' * (2^k +/- 1), which
+ * shares a common factor as addition chains do. Shift amounts which aren't
+ * available as constants yet cost a little more, so existing ones are
+ * reused whenever that's just as fast.
+ */
+class MultiplicationPlanner {
+private:
+    const long long shiftCost = 5;
+    const long long addCost = 10;
+    const long long storeCost = 10;
+    const long long newConstantCost = 2;
+
+    std::function<bool(long long)> available;
+
+    /**
+     * Best last steps by odd multipliers.
+     */
+    std::unordered_map<unsigned long long, MultiplicationStep> best;
+
+    std::unordered_map<long long, MultiplicationPlan> plans;
+
+    long long costOfShift(long long shift);
+
+    const MultiplicationStep &find(unsigned long long multiplier);
+
+public:
+    /**
+     * @param available Tells if a shift amount is already a known constant.
+     */
+    MultiplicationPlanner(std::function<bool(long long)> available) : available(std::move(available)) {}
+
+    /**
+     * Plans are remembered, so a multiplier gets the same one each time.
+     * @param multiplier A non-zero multiplier.
+     */
+    const MultiplicationPlan &plan(long long multiplier);
+
+    /**
+     * Emits the plan's steps, the accumulator holding x (-x for negative
+     * multipliers) before them.
+     * @param operand A cell holding x, used if plan.usesOperand().
+     * @param temporary A cell the steps may overwrite.
+     * @param constants Constants, with the shift amounts among them.
+     */
+    static InstructionList &emit(const MultiplicationPlan &plan, ResolvableAddress &operand, ResolvableAddress &temporary, Constants *constants);
+};
+
+#endif //COMPILER_MULTIPLICATION_H
@@ -1,3 +1,5 @@
+#include "../../front/ast/Arena.h"
+
 #ifndef COMPILER_RESOLVABLEADDRESS_H
 #define COMPILER_RESOLVABLEADDRESS_H
 
@@ -7,7 +9,7 @@
  * can be moved or modified without needing to modify those
  * instructions.
  */
-class ResolvableAddress {
+class ResolvableAddress : public ArenaObject {
 private:
     long long offset;
     long long address;
@@ -1,10 +1,18 @@
 #include "ScopedVariables.h"
+#include "../../driver/Stats.h"
+
+Variable *&ScopedVariables::binding(Symbol name) {
+    if (name >= bindings.size()) bindings.resize(Symbols::count() > name ? Symbols::count() : name + 1, nullptr);
+    return bindings[name];
+}
 
 void ScopedVariables::pushVariableScope(Variable *variable) {
-    if (!dynamic_cast<TemporaryVariable *>(variable)) {
-        for (const auto &var : variables) {
-            if (var->name == variable->name) throw "Redeclaration of variable " + var->name;
-        }
+    if (variable->kind != TEMPORARY_VARIABLE) {
+        Variable *&bound = binding(variable->name);
+        if (bound) throw "Redeclaration of variable " + Symbols::name(bound->name);
+        bound = variable;
+    } else {
+        Stats::count("temporaries");
     }
 
     variable->getAddress().setAddress(currentAddress);
@@ -15,17 +23,19 @@ void ScopedVariables::pushVariableScope(Variable *variable) {
 void ScopedVariables::popVariableScope(long long times) {
     while (times-- > 0) {
         Variable *v = variables.back();
+        if (v->kind != TEMPORARY_VARIABLE) binding(v->name) = nullptr;
 
-        currentAddress -= variables.back()->size;
+        currentAddress -= v->size;
         variables.pop_back();
     }
 }
 
-Variable *ScopedVariables::resolveVariable(std::string &name) {
-    for (const auto &variable : variables) {
-        if (dynamic_cast<TemporaryVariable *>(variable) == nullptr) {
-            if (variable->name == name) return variable;
-        }
-    }
-    throw "No variable in current scope: " + name;
-}
\ No newline at end of file
+Variable *ScopedVariables::resolveVariable(Symbol name) {
+    Variable *variable = binding(name);
+    if (variable) return variable;
+    throw "No variable in current scope: " + Symbols::name(name);
+}
+
+Variable *ScopedVariables::findVariable(Symbol name) {
+    return binding(name);
+}
@@ -9,13 +9,25 @@
 
 /**
  * A variable stack; represents variables available in
- * current scope of compilation.
+ * current scope of compilation. Besides the stack itself (which
+ * decides about memory layout and popping order) it keeps a table
+ * indexed by variables' symbols, so resolving a name doesn't depend
+ * on how many variables are in scope.
  */
 class ScopedVariables {
 private:
     std::vector<Variable *> variables;
 
+    /**
+     * Named variable currently bound to each symbol (nullptr if none).
+     * A name can't be declared twice, so a symbol is never bound to
+     * more than one variable at a time; temporaries are never bound.
+     */
+    std::vector<Variable *> bindings;
+
     long long currentAddress;
+
+    Variable *&binding(Symbol name);
 public:
     /**
      * Add a new variable to the scope.
@@ -32,7 +44,12 @@ public:
      * Resolves a whole variable (and not only its address).
      * @param name A name of a variable we want to resolve.
      */
-    Variable *resolveVariable(std::string &name);
+    Variable *resolveVariable(Symbol name);
+
+    /**
+     * @return The variable bound to a name, or nullptr if there's none.
+     */
+    Variable *findVariable(Symbol name);
 
     ScopedVariables(long long startAddress = 8) : currentAddress(startAddress) {}
 };
@@ -5,13 +5,13 @@ ResolvableAddress &Variable::getAddress() {
 }
 
 std::string NumberVariable::toString() {
-    return "NumberVariable<" + name + ">";
+    return "NumberVariable<" + Symbols::name(name) + ">";
 }
 
 std::string NumberArrayVariable::toString() {
-    return "NumberArrayVariable<" + name + ">[" + std::to_string(start) + ", " + std::to_string(end) + "]";
+    return "NumberArrayVariable<" + Symbols::name(name) + ">[" + std::to_string(start) + ", " + std::to_string(end) + "]";
 }
 
 std::string TemporaryVariable::toString() {
-    return "TemporaryVariable<" + name + ">";
+    return "TemporaryVariable<" + Symbols::name(name) + ">";
 }
\ No newline at end of file
@@ -1,19 +1,39 @@
 #include "ResolvableAddress.h"
+#include "../../front/ast/Symbols.h"
 #include <type_traits>
 #include <string>
 
 #ifndef COMPILER_VARIABLES_H
 #define COMPILER_VARIABLES_H
 
+/**
+ * Concrete type of a variable, see Node::kind.
+ */
+enum VariableKind {
+    NUMBER_VARIABLE,
+    NUMBER_ARRAY_VARIABLE,
+    TEMPORARY_VARIABLE
+};
+
 /**
  * A base class for all representable variables.
  */
-class Variable {
+class Variable : public ArenaObject {
 private:
     ResolvableAddress &address;
 public:
+    const VariableKind kind;
+
+    /**
+     * @return This variable as a T if it is one; nullptr otherwise.
+     */
+    template<class T>
+    T *as() {
+        return kind == T::KIND ? static_cast<T *>(this) : nullptr;
+    }
+
     bool initialized = false;
-    std::string &name;
+    Symbol name;
     long long size;
     bool readOnly;
 
@@ -21,8 +41,8 @@ public:
 
     virtual std::string toString() = 0;
 
-    Variable(std::string &name, ResolvableAddress &address, bool readOnly = false)
-            : name(name), address(address), readOnly(readOnly) {}
+    Variable(VariableKind kind, Symbol name, ResolvableAddress &address, bool readOnly = false)
+            : kind(kind), name(name), address(address), readOnly(readOnly) {}
 
     virtual ~Variable() {}
 };
@@ -33,8 +53,10 @@ public:
  */
 class NumberVariable : public Variable {
 public:
-    NumberVariable(std::string &name, ResolvableAddress &address, bool readOnly = false)
-            : Variable(name, address, readOnly) {
+    static const VariableKind KIND = NUMBER_VARIABLE;
+
+    NumberVariable(Symbol name, ResolvableAddress &address, bool readOnly = false)
+            : Variable(KIND, name, address, readOnly) {
         size = 1;
     }
 
@@ -46,16 +68,18 @@ public:
  */
 class NumberArrayVariable : public Variable {
 public:
+    static const VariableKind KIND = NUMBER_ARRAY_VARIABLE;
+
     long long start;
     long long end;
     bool warned = false;
 
-    NumberArrayVariable(std::string &name, ResolvableAddress &address, long long start, long long end,
+    NumberArrayVariable(Symbol name, ResolvableAddress &address, long long start, long long end,
                         bool readOnly = false)
-            : Variable(name, address, readOnly), start(start), end(end) {
+            : Variable(KIND, name, address, readOnly), start(start), end(end) {
         size = end - start + 1;
         if (end < start) {
-            throw "Trying to declare an array " + name + " starting at " + std::to_string(start) + " and ending at " + std::to_string(end);
+            throw "Trying to declare an array " + Symbols::name(name) + " starting at " + std::to_string(start) + " and ending at " + std::to_string(end);
         }
     }
 
@@ -70,10 +94,12 @@ public:
  */
 class TemporaryVariable : public Variable {
 public:
+    static const VariableKind KIND = TEMPORARY_VARIABLE;
+
     bool initialized = true;
 
-    TemporaryVariable(std::string &name, ResolvableAddress &address)
-            : Variable(name, address, true) {
+    TemporaryVariable(Symbol name, ResolvableAddress &address)
+            : Variable(KIND, name, address, true) {
         size = 1;
     }
 
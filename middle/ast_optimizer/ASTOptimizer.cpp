@@ -1,6 +1,7 @@
 #include "ASTOptimizer.h"
-
-Callback identity = [](Node *node) -> Node * { return node; };
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
 
 enum ConditionState {
     NEVER,
@@ -8,242 +9,1023 @@ enum ConditionState {
     ALWAYS
 };
 
+/**
+ * @return True if both identifiers always refer to the same memory cell.
+ */
+bool sameIdentifier(AbstractIdentifier &lhs, AbstractIdentifier &rhs) {
+    if (lhs.kind != rhs.kind || lhs.name != rhs.name) return false;
+
+    switch (lhs.kind) {
+        case VARIABLE_IDENTIFIER_NODE:
+            return true;
+        case ACCESS_IDENTIFIER_NODE:
+            return static_cast<AccessIdentifier &>(lhs).index == static_cast<AccessIdentifier &>(rhs).index;
+        case VARIABLE_ACCESS_IDENTIFIER_NODE:
+            return static_cast<VariableAccessIdentifier &>(lhs).accessName == static_cast<VariableAccessIdentifier &>(rhs).accessName;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Division rounding towards minus infinity, x / 0 being 0, just like in
+ * the generated code.
+ */
+long long floorDiv(long long lhs, long long rhs) {
+    if (rhs == 0) return 0;
+
+    long long quotient = lhs / rhs;
+    if (lhs % rhs != 0 && (lhs < 0) != (rhs < 0)) quotient--;
+    return quotient;
+}
+
+/**
+ * Remainder with the sign of the divisor, x % 0 being 0, just like in the
+ * generated code.
+ */
+long long floorMod(long long lhs, long long rhs) {
+    if (rhs == 0) return 0;
+
+    long long remainder = lhs % rhs;
+    if (remainder != 0 && (remainder < 0) != (rhs < 0)) remainder += rhs;
+    return remainder;
+}
+
+/**
+ * Computes a binary expression of two constants at compile time.
+ * @return False if the result doesn't fit in a long long; the expression
+ * is left to the generated code then.
+ */
+bool evaluate(BinaryExpressionType type, long long lhs, long long rhs, long long &result) {
+    switch (type) {
+        case ADDITION:
+            return !__builtin_add_overflow(lhs, rhs, &result);
+        case SUBTRACTION:
+            return !__builtin_sub_overflow(lhs, rhs, &result);
+        case MULTIPLICATION:
+            return !__builtin_mul_overflow(lhs, rhs, &result);
+        case DIVISION:
+            if (lhs == LLONG_MIN && rhs == -1) return false;
+            result = floorDiv(lhs, rhs);
+            return true;
+        case MODULO:
+            result = rhs == -1 ? 0 : floorMod(lhs, rhs);
+            return true;
+    }
+    return false;
+}
+
 ConditionState checkTautology(Condition &condition) {
-    try {
-        NumberValue &lVal = dynamic_cast<NumberValue &>(condition.lhs);
-        NumberValue &rVal = dynamic_cast<NumberValue &>(condition.rhs);
+    auto lNum = condition.lhs.as<NumberValue>();
+    auto rNum = condition.rhs.as<NumberValue>();
 
+    if (lNum && rNum) {
         switch (condition.type) {
             case EQUAL:
-                return lVal.value == rVal.value ? ALWAYS : NEVER;
+                return lNum->value == rNum->value ? ALWAYS : NEVER;
             case NOT_EQUAL:
-                return lVal.value != rVal.value ? ALWAYS : NEVER;
+                return lNum->value != rNum->value ? ALWAYS : NEVER;
             case LESS:
-                return lVal.value < rVal.value ? ALWAYS : NEVER;
+                return lNum->value < rNum->value ? ALWAYS : NEVER;
             case GREATER:
-                return lVal.value > rVal.value ? ALWAYS : NEVER;
+                return lNum->value > rNum->value ? ALWAYS : NEVER;
             case LESS_OR_EQUAL:
-                return lVal.value <= rVal.value ? ALWAYS : NEVER;
+                return lNum->value <= rNum->value ? ALWAYS : NEVER;
             case GREATER_OR_EQUAL:
-                return lVal.value >= rVal.value ? ALWAYS : NEVER;
-        }
-    } catch (std::bad_cast _) {
-        try {
-            IdentifierValue &lVal = dynamic_cast<IdentifierValue &>(condition.lhs);
-            IdentifierValue &rVal = dynamic_cast<IdentifierValue &>(condition.rhs);
-
-            try {
-                VariableIdentifier &lValId = dynamic_cast<VariableIdentifier &>(lVal.identifier);
-                VariableIdentifier &rValId = dynamic_cast<VariableIdentifier &>(rVal.identifier);
-
-                if (lValId.name == rValId.name) {
-                    switch (condition.type) {
-                        case EQUAL:
-                        case LESS_OR_EQUAL:
-                        case GREATER_OR_EQUAL:
-                            return ALWAYS;
-                        case NOT_EQUAL:
-                        case LESS:
-                        case GREATER:
-                            return NEVER;
-                    }
-                } else return SOMETIMES;
-            } catch (std::bad_cast _) {
-                try {
-                    AccessIdentifier &lValAcc = dynamic_cast<AccessIdentifier &>(lVal.identifier);
-                    AccessIdentifier &rValAcc = dynamic_cast<AccessIdentifier &>(rVal.identifier);
-
-                    if (lValAcc.name == rValAcc.name && lValAcc.index == rValAcc.index) {
-                        switch (condition.type) {
-                            case EQUAL:
-                            case LESS_OR_EQUAL:
-                            case GREATER_OR_EQUAL:
-                                return ALWAYS;
-                            case NOT_EQUAL:
-                            case LESS:
-                            case GREATER:
-                                return NEVER;
-                        }
-                    } else return SOMETIMES;
-                } catch (std::bad_cast) {
-                    try {
-                        VariableAccessIdentifier &lValVarAcc = dynamic_cast<VariableAccessIdentifier &>(lVal.identifier);
-                        VariableAccessIdentifier &rValVarAcc = dynamic_cast<VariableAccessIdentifier &>(rVal.identifier);
-
-                        if (lValVarAcc.name == rValVarAcc.name && lValVarAcc.accessName == rValVarAcc.accessName) {
-                            switch (condition.type) {
-                                case EQUAL:
-                                case LESS_OR_EQUAL:
-                                case GREATER_OR_EQUAL:
-                                    return ALWAYS;
-                                case NOT_EQUAL:
-                                case LESS:
-                                case GREATER:
-                                    return NEVER;
-                            }
-                        } else return SOMETIMES;
-                    } catch (std::bad_cast _) {}
-                }
-            }
-        } catch (std::bad_cast _) {}
+                return lNum->value >= rNum->value ? ALWAYS : NEVER;
+        }
+    }
+
+    auto lVal = condition.lhs.as<IdentifierValue>();
+    auto rVal = condition.rhs.as<IdentifierValue>();
+
+    if (lVal && rVal && sameIdentifier(lVal->identifier, rVal->identifier)) {
+        switch (condition.type) {
+            case EQUAL:
+            case LESS_OR_EQUAL:
+            case GREATER_OR_EQUAL:
+                return ALWAYS;
+            case NOT_EQUAL:
+            case LESS:
+            case GREATER:
+                return NEVER;
+        }
     }
     return SOMETIMES;
 }
 
-bool ASTOptimizer::traverse(CommandList &commandList, Callback callback) {
-    bool changed = false;
-    for (int i = 0; i < commandList.commands.size(); i++) {
-        Node *newNode = callback(commandList.commands[i]);
-        if (newNode != commandList.commands[i]) {
-            commandList.commands[i] = newNode;
-            changed = true;
+void ASTOptimizer::addRule(std::string description, Callback rule) {
+    rules.push_back(RewriteRule{description, rule, 0});
+}
+
+Node *ASTOptimizer::applyRules(Node *node) {
+    for (auto &rule : rules) {
+        Node *replacement = rule.rewrite(node);
+        if (replacement != node) {
+            rule.applied++;
+            return replacement;
         }
-        traverse(commandList.commands[i], callback);
     }
-    return changed;
+    return node;
 }
 
-bool ASTOptimizer::traverse(Node *node, Callback callback) {
-    if (auto cmdList = dynamic_cast<CommandList *>(node)) {
-        return traverse(*cmdList, callback);
-    } else if (auto whileNode = dynamic_cast<While *>(node)) {
-        return traverse(whileNode->commands, callback);
-    } else if (auto forNode = dynamic_cast<For *>(node)) {
-        return traverse(forNode->commands, callback);
-    } else if (auto ifNode = dynamic_cast<If *>(node)) {
-        return traverse(ifNode->commands, callback);
-    } else if (auto ifElse = dynamic_cast<IfElse *>(node)) {
-        return traverse(ifElse->commands, callback) || traverse(ifElse->elseCommands, callback);
+void ASTOptimizer::rewrite(CommandList &commandList) {
+    for (size_t i = 0; i < commandList.commands.size(); i++) {
+        commandList.commands[i] = rewrite(commandList.commands[i]);
     }
-    return false;
 }
 
-Node *ASTOptimizer::constantExpressionOptimizer(Node *node) {
-    if (auto assignNode = dynamic_cast<Assignment *>(node)) {
-        try {
-            auto binaryExpression = dynamic_cast<BinaryExpression &>(assignNode->expression);
-            try {
-                auto lhsConstant = dynamic_cast<NumberValue &>(binaryExpression.lhs);
-                try {
-                    auto rhsConstant = dynamic_cast<NumberValue &>(binaryExpression.rhs);
-
-                    long long newValue = 0;
-                    switch (binaryExpression.type) {
-                        case ADDITION:
-                            newValue = lhsConstant.value + rhsConstant.value;
-                            break;
-                        case SUBTRACTION:
-                            newValue = lhsConstant.value - rhsConstant.value;
-                            break;
-                        case MULTIPLICATION:
-                            newValue = lhsConstant.value * rhsConstant.value;
-                            break;
-                        case DIVISION:
-                            newValue = floor((double) lhsConstant.value / (double) rhsConstant.value);
-                            break;
-                        case MODULO:
-                            newValue = lhsConstant.value - floor((double) lhsConstant.value / (double) rhsConstant.value) * rhsConstant.value;
-                            break;
-                    }
+/**
+ * @return Whether the list is one of the node's own command lists.
+ */
+static bool ownsCommands(Node *node, Node *list) {
+    switch (node->kind) {
+        case WHILE_NODE:
+            return list == &static_cast<While *>(node)->commands;
+        case FOR_NODE:
+            return list == &static_cast<For *>(node)->commands;
+        case IF_NODE:
+            return list == &static_cast<If *>(node)->commands;
+        case IF_ELSE_NODE:
+            return list == &static_cast<IfElse *>(node)->commands || list == &static_cast<IfElse *>(node)->elseCommands;
+        default:
+            return false;
+    }
+}
 
-                    originalProgram->constants.constants.push_back(newValue);
+Node *ASTOptimizer::rewrite(Node *node) {
+    rewriteChildren(node);
 
-                    return new Assignment(assignNode->identifier, *new UnaryExpression(*new NumberValue(newValue)));
-                } catch (std::bad_cast _) {}
-            } catch (std::bad_cast _) {}
-        } catch (std::bad_cast _) {}
+    Node *replacement;
+    while ((replacement = applyRules(node)) != node) {
+        bool rewritten = ownsCommands(node, replacement); // e.g. the commands of an IF which always holds
+        node = replacement;
+        if (!rewritten) rewriteChildren(node); // only a new replacement (e.g. an unrolled loop body) is visited again
     }
     return node;
 }
 
-Node *ASTOptimizer::constantLoopUnroller(Node *node) {
-    if (auto forNode = dynamic_cast<For *>(node)) {
-        try {
-            auto startConstant = dynamic_cast<NumberValue &>(forNode->startValue);
-            try {
-                auto endConstant = dynamic_cast<NumberValue &>(forNode->endValue);
-
-                CommandList *cmdList = new CommandList();
-
-                if (forNode->reversed) {
-                    for (long long i = startConstant.value; i >= endConstant.value; i--) {
-                        Callback replacer = iteratorReplacer(forNode->variableName, i);
-                        originalProgram->constants.constants.push_back(i);
-                        cmdList->append(*static_cast<CommandList *>(forNode->commands.copy(replacer)));
-                    }
-                } else {
-                    for (long long i = startConstant.value; i <= endConstant.value; i++) {
-                        Callback replacer = iteratorReplacer(forNode->variableName, i);
-                        originalProgram->constants.constants.push_back(i);
-                        cmdList->append(*static_cast<CommandList *>(forNode->commands.copy(replacer)));
-                    }
+void ASTOptimizer::rewriteChildren(Node *node) {
+    switch (node->kind) {
+        case COMMAND_LIST_NODE:
+            rewrite(*static_cast<CommandList *>(node));
+            break;
+        case WHILE_NODE:
+            rewrite(static_cast<While *>(node)->commands);
+            break;
+        case FOR_NODE:
+            rewrite(static_cast<For *>(node)->commands);
+            break;
+        case IF_NODE:
+            rewrite(static_cast<If *>(node)->commands);
+            break;
+        case IF_ELSE_NODE:
+            rewrite(static_cast<IfElse *>(node)->commands);
+            rewrite(static_cast<IfElse *>(node)->elseCommands);
+            break;
+        default:
+            break;
+    }
+}
+
+Node *ASTOptimizer::constantExpressionOptimizer(Node *node) {
+    auto assignNode = node->as<Assignment>();
+    if (!assignNode) return node;
+
+    auto binaryExpression = assignNode->expression.as<BinaryExpression>();
+    if (!binaryExpression) return node;
+
+    auto lhsConstant = binaryExpression->lhs.as<NumberValue>();
+    auto rhsConstant = binaryExpression->rhs.as<NumberValue>();
+    if (!lhsConstant || !rhsConstant) return node;
+
+    long long newValue;
+    if (!evaluate(binaryExpression->type, lhsConstant->value, rhsConstant->value, newValue)) return node;
+
+    originalProgram->constants.add(newValue);
+
+    return new Assignment(assignNode->identifier, *new UnaryExpression(*new NumberValue(newValue)));
+}
+
+long long ASTOptimizer::estimateSize(Node *node) {
+    switch (node->kind) {
+        case COMMAND_LIST_NODE: {
+            long long size = 0;
+            for (auto const &command : static_cast<CommandList *>(node)->commands) size += estimateSize(command);
+            return size;
+        }
+        case ASSIGNMENT_NODE: {
+            auto assignNode = static_cast<Assignment *>(node);
+            long long size = assignNode->identifier.kind == VARIABLE_ACCESS_IDENTIFIER_NODE ? 6 : 2;
+
+            if (auto binaryExpression = assignNode->expression.as<BinaryExpression>()) {
+                switch (binaryExpression->type) {
+                    case ADDITION:
+                    case SUBTRACTION:
+                        return size + 4;
+                    case MULTIPLICATION:
+                        return size + 30;
+                    case DIVISION:
+                    case MODULO:
+                        return size + 70;
                 }
+            }
+            return size + 2;
+        }
+        case IF_NODE:
+            return 4 + estimateSize(&static_cast<If *>(node)->commands);
+        case IF_ELSE_NODE:
+            return 5 + estimateSize(&static_cast<IfElse *>(node)->commands) + estimateSize(&static_cast<IfElse *>(node)->elseCommands);
+        case WHILE_NODE:
+            return 5 + estimateSize(&static_cast<While *>(node)->commands);
+        case FOR_NODE: {
+            auto forNode = static_cast<For *>(node);
+            return 10 + forNode->unroll * (3 + estimateSize(&forNode->commands));
+        }
+        default: // READ, WRITE
+            return 3;
+    }
+}
+
+Node *ASTOptimizer::constantLoopUnroller(Node *node) {
+    auto forNode = node->as<For>();
+    if (!forNode || forNode->unroll > 1) return node; // partially unrolled loops were already decided on
+
+    auto startConstant = forNode->startValue.as<NumberValue>();
+    auto endConstant = forNode->endValue.as<NumberValue>();
+    if (!startConstant || !endConstant) return node;
+
+    long long iterations = forNode->reversed ? startConstant->value - endConstant->value + 1 : endConstant->value - startConstant->value + 1;
+    if (iterations < 0) iterations = 0;
 
-                return cmdList;
-            } catch (std::bad_cast _) {}
-        } catch (std::bad_cast _) {}
+    long long bodySize = std::max(estimateSize(&forNode->commands), 1LL);
+    long long step = forNode->reversed ? -1 : 1;
+
+    // every unrolled iteration saves the iterator bookkeeping (about 33 VM cost units) and turns a[i] into
+    // a direct access, so the only limit is the size of the code emitted
+    if (iterations <= unrollBudget / bodySize) {
+        CommandList *cmdList = new CommandList();
+        unrollIterations(*cmdList, *forNode, startConstant->value, iterations);
+        return cmdList;
     }
-    return node;
+
+    long long factor = MAX_UNROLL_FACTOR;
+    while (factor > 1 && (factor + iterations % factor) * bodySize > unrollBudget) factor--;
+    if (factor == 1) return node; // keep it as an ordinary loop
+
+    // FOR i FROM s TO e ==> FOR i FROM s TO s + k*q - 1 (k copies per check) + remaining iterations unrolled
+    long long loopIterations = iterations - iterations % factor;
+    long long loopEnd = startConstant->value + step * (loopIterations - 1);
+    originalProgram->constants.add(loopEnd);
+
+    CommandList *cmdList = new CommandList();
+    cmdList->commands.push_back(new For(forNode->variableName, forNode->startValue, *new NumberValue(loopEnd), forNode->commands, forNode->reversed, factor));
+    unrollIterations(*cmdList, *forNode, loopEnd + step, iterations % factor);
+    return cmdList;
+}
+
+void ASTOptimizer::unrollIterations(CommandList &commandList, For &forNode, long long from, long long count) {
+    long long step = forNode.reversed ? -1 : 1;
+
+    for (long long i = 0; i < count; i++) {
+        long long value = from + step * i;
+        Callback replacer = iteratorReplacer(forNode.variableName, value);
+        originalProgram->constants.add(value);
+        commandList.append(*static_cast<CommandList *>(forNode.commands.copy(replacer)));
+    }
+    Stats::count("unrolled iterations", count);
 }
 
 Node *ASTOptimizer::constantConditionRemover(Node *node) {
-    if (auto whileNode = dynamic_cast<While *>(node)) {
-        if (checkTautology(whileNode->condition) == ALWAYS) {
-            std::cout << "  |[w] Infinite loop detected" << std::endl;
-            return node;
-        } else if (checkTautology(whileNode->condition) == NEVER) {
-            return new CommandList();
+    switch (node->kind) {
+        case WHILE_NODE: {
+            auto whileNode = static_cast<While *>(node);
+            if (checkTautology(whileNode->condition) == ALWAYS) {
+                Diagnostics::out() << "  |[w] Infinite loop detected" << std::endl;
+                return node;
+            } else if (checkTautology(whileNode->condition) == NEVER) {
+                return whileNode->doWhile ? &whileNode->commands : new CommandList(); // a do-while runs once anyway
+            }
+            break;
         }
-    } else if (auto ifNode = dynamic_cast<If *>(node)) {
-        if (checkTautology(ifNode->condition) == ALWAYS) {
-            return ifNode->commands.copy(identity);
-        } else if (checkTautology(ifNode->condition) == NEVER) {
-            return new CommandList();
+        case IF_NODE: {
+            auto ifNode = static_cast<If *>(node);
+            if (checkTautology(ifNode->condition) == ALWAYS) {
+                return &ifNode->commands; // its commands are already rewritten
+            } else if (checkTautology(ifNode->condition) == NEVER) {
+                return new CommandList();
+            }
+            break;
         }
-    } else if (auto ifElseNode = dynamic_cast<IfElse *>(node)) {
-        if (checkTautology(ifElseNode->condition) == ALWAYS) {
-            return ifElseNode->commands.copy(identity);
-        } else if (checkTautology(ifElseNode->condition) == NEVER) {
-            return ifElseNode->elseCommands.copy(identity);
+        case IF_ELSE_NODE: {
+            auto ifElseNode = static_cast<IfElse *>(node);
+            if (checkTautology(ifElseNode->condition) == ALWAYS) {
+                return &ifElseNode->commands;
+            } else if (checkTautology(ifElseNode->condition) == NEVER) {
+                return &ifElseNode->elseCommands;
+            }
+            break;
         }
+        default:
+            break;
     }
     return node;
 }
 
-Callback ASTOptimizer::iteratorReplacer(std::string &variableToReplace, long long value) {
+Callback ASTOptimizer::iteratorReplacer(Symbol variableToReplace, long long value) {
     return [this, variableToReplace, value](Node *node) -> Node * {
-        if (auto idVal = dynamic_cast<IdentifierValue *>(node)) {
-            try {
-                VariableIdentifier &varId = dynamic_cast<VariableIdentifier &>(idVal->identifier);
-
-                if (varId.name == variableToReplace) {
-                    return new NumberValue(value);
-                }
-            } catch (std::bad_cast _) {
-                try {
-                    VariableAccessIdentifier &varAccId = dynamic_cast<VariableAccessIdentifier &>(idVal->identifier);
+        switch (node->kind) {
+            case IDENTIFIER_VALUE_NODE: {
+                AbstractIdentifier &identifier = static_cast<IdentifierValue *>(node)->identifier;
 
-                    if (varAccId.accessName == variableToReplace) {
-                        return new IdentifierValue(*new AccessIdentifier(varAccId.name, value));
+                if (auto varId = identifier.as<VariableIdentifier>()) {
+                    if (varId->name == variableToReplace) {
+                        return new NumberValue(value);
+                    }
+                } else if (auto varAccId = identifier.as<VariableAccessIdentifier>()) {
+                    if (varAccId->accessName == variableToReplace) {
+                        return new IdentifierValue(*new AccessIdentifier(varAccId->name, value));
                     }
-                } catch (std::bad_cast _) {}
+                }
+                break;
+            }
+            case VARIABLE_ACCESS_IDENTIFIER_NODE: {
+                auto varArrId = static_cast<VariableAccessIdentifier *>(node);
+                if (varArrId->accessName == variableToReplace) return new AccessIdentifier(varArrId->name, value);
+                break;
             }
-        } else if (auto varArrId = dynamic_cast<VariableAccessIdentifier *>(node)) {
-            if (varArrId->accessName == variableToReplace) return new AccessIdentifier(varArrId->name, value);
+            default:
+                break;
         }
         return node;
     };
 }
 
+void ASTOptimizer::propagateValues() {
+    slots.assign(Symbols::count(), -1);
+    scalars.clear();
+    for (auto const &declaration : originalProgram->declarations.declarations) {
+        if (auto numDecl = declaration->as<IdentifierDeclaration>()) {
+            if (numDecl->name >= slots.size()) slots.resize(numDecl->name + 1, -1);
+            if (slots[numDecl->name] >= 0) continue; // a redeclaration, reported by the assembler
+            slots[numDecl->name] = scalars.size();
+            scalars.push_back(numDecl->name);
+        }
+    }
+    for (auto const &declaration : originalProgram->declarations.declarations) {
+        if (auto arrDecl = declaration->as<ArrayDeclaration>()) {
+            if (slot(arrDecl->name) >= 0) slots[arrDecl->name] = -1; // clashes with an array; let the assembler complain
+        }
+    }
+
+    KnownValues known;
+    known.values.resize(scalars.size());
+    known.versions.resize(scalars.size(), 0);
+    propagate(originalProgram->commands, known);
+}
+
+void ASTOptimizer::propagate(CommandList &commandList, KnownValues &known) {
+    for (auto &command : commandList.commands) {
+        command = propagate(command, known);
+    }
+}
+
+Node *ASTOptimizer::propagate(Node *node, KnownValues &known) {
+    switch (node->kind) {
+        case COMMAND_LIST_NODE:
+            propagate(*static_cast<CommandList *>(node), known);
+            return node;
+        case ASSIGNMENT_NODE: {
+            auto assignNode = static_cast<Assignment *>(node);
+            AbstractIdentifier *identifier = substitute(assignNode->identifier, known);
+            AbstractExpression *expression = &assignNode->expression;
+
+            if (auto unaryExpression = expression->as<UnaryExpression>()) {
+                AbstractValue *value = substitute(unaryExpression->value, known);
+                if (value != &unaryExpression->value) expression = new UnaryExpression(*value);
+            } else if (auto binaryExpression = expression->as<BinaryExpression>()) {
+                AbstractValue *lhs = substitute(binaryExpression->lhs, known);
+                AbstractValue *rhs = substitute(binaryExpression->rhs, known);
+
+                auto lhsConstant = lhs->as<NumberValue>();
+                auto rhsConstant = rhs->as<NumberValue>();
+                long long result;
+                if (lhsConstant && rhsConstant && evaluate(binaryExpression->type, lhsConstant->value, rhsConstant->value, result)) {
+                    originalProgram->constants.add(result);
+                    expression = new UnaryExpression(*new NumberValue(result));
+                } else if (lhs != &binaryExpression->lhs || rhs != &binaryExpression->rhs) {
+                    expression = new BinaryExpression(*lhs, *rhs, binaryExpression->type);
+                }
+            }
+
+            if (identifier->kind == VARIABLE_IDENTIFIER_NODE && slot(identifier->name) >= 0) {
+                assign(known, slot(identifier->name), expression);
+            }
+
+            if (identifier == &assignNode->identifier && expression == &assignNode->expression) return node;
+            return new Assignment(*identifier, *expression);
+        }
+        case READ_NODE: {
+            auto readNode = static_cast<Read *>(node);
+            AbstractIdentifier *identifier = substitute(readNode->identifier, known);
+
+            if (identifier->kind == VARIABLE_IDENTIFIER_NODE && slot(identifier->name) >= 0) {
+                assign(known, slot(identifier->name), nullptr);
+            }
+            return identifier == &readNode->identifier ? node : new Read(*identifier);
+        }
+        case WRITE_NODE: {
+            auto writeNode = static_cast<Write *>(node);
+            AbstractValue *value = substitute(writeNode->value, known);
+            return value == &writeNode->value ? node : new Write(*value);
+        }
+        case IF_NODE: {
+            auto ifNode = static_cast<If *>(node);
+            Condition *condition = substitute(ifNode->condition, known);
+
+            switch (checkTautology(*condition)) {
+                case ALWAYS:
+                    deadBranches++;
+                    propagate(ifNode->commands, known);
+                    return &ifNode->commands;
+                case NEVER:
+                    deadBranches++;
+                    return new CommandList();
+                default:
+                    break;
+            }
+
+            KnownValues thenKnown = known;
+            propagate(ifNode->commands, thenKnown);
+            merge(known, thenKnown);
+            return condition == &ifNode->condition ? node : new If(*condition, ifNode->commands);
+        }
+        case IF_ELSE_NODE: {
+            auto ifElseNode = static_cast<IfElse *>(node);
+            Condition *condition = substitute(ifElseNode->condition, known);
+
+            switch (checkTautology(*condition)) {
+                case ALWAYS:
+                    deadBranches++;
+                    propagate(ifElseNode->commands, known);
+                    return &ifElseNode->commands;
+                case NEVER:
+                    deadBranches++;
+                    propagate(ifElseNode->elseCommands, known);
+                    return &ifElseNode->elseCommands;
+                default:
+                    break;
+            }
+
+            KnownValues elseKnown = known;
+            propagate(ifElseNode->commands, known);
+            propagate(ifElseNode->elseCommands, elseKnown);
+            merge(known, elseKnown);
+            return condition == &ifElseNode->condition ? node : new IfElse(*condition, ifElseNode->commands, ifElseNode->elseCommands);
+        }
+        case WHILE_NODE: {
+            auto whileNode = static_cast<While *>(node);
+            forgetWrites(&whileNode->commands, known); // the condition is checked after any number of iterations
+            Condition *condition = substitute(whileNode->condition, known);
+
+            if (checkTautology(*condition) == NEVER) {
+                deadBranches++;
+                if (!whileNode->doWhile) return new CommandList();
+
+                propagate(whileNode->commands, known);
+                return &whileNode->commands;
+            }
+
+            KnownValues bodyKnown = known;
+            propagate(whileNode->commands, bodyKnown);
+            return condition == &whileNode->condition ? node : new While(*condition, whileNode->commands, whileNode->doWhile);
+        }
+        case FOR_NODE: {
+            auto forNode = static_cast<For *>(node);
+            AbstractValue *startValue = substitute(forNode->startValue, known); // both are evaluated once, before the loop
+            AbstractValue *endValue = substitute(forNode->endValue, known);
+            forgetWrites(&forNode->commands, known);
+
+            KnownValues bodyKnown = known;
+            propagate(forNode->commands, bodyKnown);
+
+            if (startValue == &forNode->startValue && endValue == &forNode->endValue) return node;
+            return new For(forNode->variableName, *startValue, *endValue, forNode->commands, forNode->reversed, forNode->unroll);
+        }
+        default:
+            return node;
+    }
+}
+
+const KnownValue *ASTOptimizer::knownValue(KnownValues &known, Symbol name) {
+    if (slot(name) < 0) return nullptr;
+
+    const KnownValue &value = known.values[slot(name)];
+    switch (value.state) {
+        case CONSTANT_VALUE:
+            return &value;
+        case COPIED_VALUE:
+            return known.versions[value.source] == value.sourceVersion ? &value : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+AbstractValue *ASTOptimizer::substitute(AbstractValue &value, KnownValues &known) {
+    auto identifierValue = value.as<IdentifierValue>();
+    if (!identifierValue) return &value;
+
+    if (auto varId = identifierValue->identifier.as<VariableIdentifier>()) {
+        const KnownValue *knownVariable = knownValue(known, varId->name);
+        if (!knownVariable) return &value;
+
+        propagatedValues++;
+        if (knownVariable->state == CONSTANT_VALUE) {
+            originalProgram->constants.add(knownVariable->value);
+            return new NumberValue(knownVariable->value);
+        }
+        return new IdentifierValue(*new VariableIdentifier(scalars[knownVariable->source]));
+    }
+
+    AbstractIdentifier *identifier = substitute(identifierValue->identifier, known);
+    return identifier == &identifierValue->identifier ? &value : new IdentifierValue(*identifier);
+}
+
+AbstractIdentifier *ASTOptimizer::substitute(AbstractIdentifier &identifier, KnownValues &known) {
+    auto varAccId = identifier.as<VariableAccessIdentifier>();
+    if (!varAccId) return &identifier;
+
+    const KnownValue *knownIndex = knownValue(known, varAccId->accessName);
+    if (!knownIndex) return &identifier;
+
+    propagatedValues++;
+    if (knownIndex->state == CONSTANT_VALUE) return new AccessIdentifier(varAccId->name, knownIndex->value);
+    return new VariableAccessIdentifier(varAccId->name, scalars[knownIndex->source]);
+}
+
+Condition *ASTOptimizer::substitute(Condition &condition, KnownValues &known) {
+    AbstractValue *lhs = substitute(condition.lhs, known);
+    AbstractValue *rhs = substitute(condition.rhs, known);
+    return lhs == &condition.lhs && rhs == &condition.rhs ? &condition : new Condition(*lhs, *rhs, condition.type);
+}
+
+void ASTOptimizer::assign(KnownValues &known, int target, AbstractExpression *expression) {
+    KnownValue value;
+
+    if (auto unaryExpression = expression ? expression->as<UnaryExpression>() : nullptr) {
+        if (auto numberValue = unaryExpression->value.as<NumberValue>()) {
+            value.state = CONSTANT_VALUE;
+            value.value = numberValue->value;
+        } else if (auto identifierValue = unaryExpression->value.as<IdentifierValue>()) {
+            Symbol name = identifierValue->identifier.name;
+            int source = identifierValue->identifier.kind == VARIABLE_IDENTIFIER_NODE ? slot(name) : -1;
+
+            if (source >= 0 && source != target) { // known values of the source are already substituted, so this is the original
+                value.state = COPIED_VALUE;
+                value.source = source;
+                value.sourceVersion = known.versions[source];
+            }
+        }
+    }
+
+    known.versions[target] = ++lastVersion;
+    known.values[target] = value;
+}
+
+void ASTOptimizer::forgetWrites(Node *node, KnownValues &known) {
+    switch (node->kind) {
+        case COMMAND_LIST_NODE:
+            for (auto const &command : static_cast<CommandList *>(node)->commands) forgetWrites(command, known);
+            break;
+        case ASSIGNMENT_NODE:
+        case READ_NODE: {
+            AbstractIdentifier &identifier = node->kind == ASSIGNMENT_NODE ? static_cast<Assignment *>(node)->identifier : static_cast<Read *>(node)->identifier;
+            if (identifier.kind == VARIABLE_IDENTIFIER_NODE && slot(identifier.name) >= 0) assign(known, slot(identifier.name), nullptr);
+            break;
+        }
+        case IF_NODE:
+            forgetWrites(&static_cast<If *>(node)->commands, known);
+            break;
+        case IF_ELSE_NODE:
+            forgetWrites(&static_cast<IfElse *>(node)->commands, known);
+            forgetWrites(&static_cast<IfElse *>(node)->elseCommands, known);
+            break;
+        case WHILE_NODE:
+            forgetWrites(&static_cast<While *>(node)->commands, known);
+            break;
+        case FOR_NODE:
+            forgetWrites(&static_cast<For *>(node)->commands, known);
+            break;
+        default:
+            break;
+    }
+}
+
+void ASTOptimizer::merge(KnownValues &known, KnownValues &other) {
+    for (size_t i = 0; i < known.values.size(); i++) {
+        KnownValue &mine = known.values[i];
+        const KnownValue &theirs = other.values[i];
+
+        bool same = mine.state == theirs.state;
+        if (mine.state == CONSTANT_VALUE) {
+            same = same && mine.value == theirs.value;
+        } else if (mine.state == COPIED_VALUE) { // valid on both paths only if the source has the same version on both
+            same = same && mine.source == theirs.source && mine.sourceVersion == theirs.sourceVersion
+                   && known.versions[mine.source] == mine.sourceVersion && other.versions[mine.source] == mine.sourceVersion;
+        }
+        if (!same) mine = KnownValue();
+    }
+
+    for (size_t i = 0; i < known.versions.size(); i++) {
+        if (known.versions[i] != other.versions[i]) known.versions[i] = ++lastVersion;
+    }
+}
+
+void ASTOptimizer::hoistInvariants(CommandList &commandList) {
+    for (auto &command : commandList.commands) {
+        switch (command->kind) {
+            case COMMAND_LIST_NODE:
+                hoistInvariants(*static_cast<CommandList *>(command));
+                break;
+            case IF_NODE:
+                hoistInvariants(static_cast<If *>(command)->commands);
+                break;
+            case IF_ELSE_NODE:
+                hoistInvariants(static_cast<IfElse *>(command)->commands);
+                hoistInvariants(static_cast<IfElse *>(command)->elseCommands);
+                break;
+            case WHILE_NODE:
+            case FOR_NODE: {
+                hoistInvariants(command->kind == WHILE_NODE ? static_cast<While *>(command)->commands : static_cast<For *>(command)->commands);
+
+                CommandList *preheader = hoistInvariants(command);
+                if (!preheader->commands.empty()) {
+                    preheader->commands.push_back(command);
+                    command = preheader; // an enclosing loop sees the hoisted assignments as its own
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+CommandList *ASTOptimizer::hoistInvariants(Node *&loop) {
+    LoopHoisting hoisting(*new CommandList());
+    collectWrites(loop, hoisting.written);
+
+    if (auto whileNode = loop->as<While>()) {
+        hoisting.everyIteration = true; // the condition is checked at least once
+        Condition *condition = hoist(whileNode->condition, hoisting);
+        if (condition != &whileNode->condition) loop = new While(*condition, whileNode->commands, whileNode->doWhile);
+        hoisting.everyIteration = whileNode->doWhile;
+        hoistInvariants(whileNode->commands, hoisting);
+    } else if (auto forNode = loop->as<For>()) { // its bounds are evaluated once anyway
+        auto start = forNode->startValue.as<NumberValue>();
+        auto end = forNode->endValue.as<NumberValue>();
+        hoisting.everyIteration = start && end && (forNode->reversed ? start->value >= end->value : start->value <= end->value);
+        hoistInvariants(forNode->commands, hoisting);
+    }
+    return &hoisting.preheader;
+}
+
+void ASTOptimizer::hoistInvariants(CommandList &commandList, LoopHoisting &loop) {
+    for (auto &command : commandList.commands) {
+        hoist(command, loop);
+    }
+}
+
+void ASTOptimizer::hoistConditionally(CommandList &commandList, LoopHoisting &loop) {
+    bool everyIteration = loop.everyIteration;
+    loop.everyIteration = false;
+    hoistInvariants(commandList, loop);
+    loop.everyIteration = everyIteration;
+}
+
+void ASTOptimizer::hoist(Node *&command, LoopHoisting &loop) {
+    switch (command->kind) {
+        case COMMAND_LIST_NODE:
+            hoistInvariants(*static_cast<CommandList *>(command), loop);
+            break;
+        case ASSIGNMENT_NODE: {
+            auto assignNode = static_cast<Assignment *>(command);
+
+            if (hoistedTemporaries.count(assignNode->identifier.name)) { // hoisted out of an inner loop; maybe out of this one too
+                auto binaryExpression = assignNode->expression.as<BinaryExpression>();
+                auto unaryExpression = assignNode->expression.as<UnaryExpression>();
+                bool invariantExpression = binaryExpression ? hoistable(binaryExpression->lhs, loop) && hoistable(binaryExpression->rhs, loop)
+                                                            : hoistable(unaryExpression->value, loop);
+                if (invariantExpression) {
+                    loop.preheader.commands.push_back(command);
+                    loop.written.erase(assignNode->identifier.name); // its only assignment is out of the loop now
+                    command = new CommandList();
+                    hoistedInvariants++;
+                }
+                break;
+            }
+
+            AbstractExpression *expression = hoist(assignNode->expression, loop);
+            if (expression != &assignNode->expression) command = new Assignment(assignNode->identifier, *expression);
+            break;
+        }
+        case WRITE_NODE: {
+            auto writeNode = static_cast<Write *>(command);
+            AbstractValue *value = hoist(writeNode->value, loop);
+            if (value != &writeNode->value) command = new Write(*value);
+            break;
+        }
+        case IF_NODE: {
+            auto ifNode = static_cast<If *>(command);
+            Condition *condition = hoist(ifNode->condition, loop);
+            hoistConditionally(ifNode->commands, loop);
+            if (condition != &ifNode->condition) command = new If(*condition, ifNode->commands);
+            break;
+        }
+        case IF_ELSE_NODE: {
+            auto ifElseNode = static_cast<IfElse *>(command);
+            Condition *condition = hoist(ifElseNode->condition, loop);
+            hoistConditionally(ifElseNode->commands, loop);
+            hoistConditionally(ifElseNode->elseCommands, loop);
+            if (condition != &ifElseNode->condition) command = new IfElse(*condition, ifElseNode->commands, ifElseNode->elseCommands);
+            break;
+        }
+        case WHILE_NODE: {
+            auto whileNode = static_cast<While *>(command);
+            Condition *condition = hoist(whileNode->condition, loop);
+            hoistConditionally(whileNode->commands, loop);
+            if (condition != &whileNode->condition) command = new While(*condition, whileNode->commands, whileNode->doWhile);
+            break;
+        }
+        case FOR_NODE: {
+            auto forNode = static_cast<For *>(command);
+            AbstractValue *startValue = hoist(forNode->startValue, loop);
+            AbstractValue *endValue = hoist(forNode->endValue, loop);
+            hoistConditionally(forNode->commands, loop);
+            if (startValue != &forNode->startValue || endValue != &forNode->endValue) {
+                command = new For(forNode->variableName, *startValue, *endValue, forNode->commands, forNode->reversed, forNode->unroll);
+            }
+            break;
+        }
+        default: // READ
+            break;
+    }
+}
+
+AbstractExpression *ASTOptimizer::hoist(AbstractExpression &expression, LoopHoisting &loop) {
+    if (auto unaryExpression = expression.as<UnaryExpression>()) {
+        AbstractValue *value = hoist(unaryExpression->value, loop);
+        return value == &unaryExpression->value ? &expression : new UnaryExpression(*value);
+    }
+
+    auto binaryExpression = static_cast<BinaryExpression *>(&expression);
+    if (hoistable(binaryExpression->lhs, loop) && hoistable(binaryExpression->rhs, loop)) {
+        auto lhsConstant = binaryExpression->lhs.as<NumberValue>();
+        auto rhsConstant = binaryExpression->rhs.as<NumberValue>();
+        bool cheap = (binaryExpression->type == ADDITION || binaryExpression->type == SUBTRACTION)
+                     && ((lhsConstant && llabs(lhsConstant->value) < 10) || (rhsConstant && llabs(rhsConstant->value) < 10)); // a few INCs/DECs, as cheap as a LOAD
+
+        if (!cheap) return new UnaryExpression(*new IdentifierValue(*new VariableIdentifier(hoistedTemporary(expression, loop))));
+    }
+
+    AbstractValue *lhs = hoist(binaryExpression->lhs, loop);
+    AbstractValue *rhs = hoist(binaryExpression->rhs, loop);
+    if (lhs == &binaryExpression->lhs && rhs == &binaryExpression->rhs) return &expression;
+    return new BinaryExpression(*lhs, *rhs, binaryExpression->type);
+}
+
+AbstractValue *ASTOptimizer::hoist(AbstractValue &value, LoopHoisting &loop) {
+    auto identifierValue = value.as<IdentifierValue>();
+    if (!identifierValue || identifierValue->identifier.kind != VARIABLE_ACCESS_IDENTIFIER_NODE || !hoistable(value, loop)) return &value;
+
+    // a[b] costs LOAD b; SUB start; ADD address; LOADI each time, but a hoisted one just a LOAD
+    return new IdentifierValue(*new VariableIdentifier(hoistedTemporary(*new UnaryExpression(value), loop)));
+}
+
+Condition *ASTOptimizer::hoist(Condition &condition, LoopHoisting &loop) {
+    AbstractValue *lhs = hoist(condition.lhs, loop);
+    AbstractValue *rhs = hoist(condition.rhs, loop);
+    return lhs == &condition.lhs && rhs == &condition.rhs ? &condition : new Condition(*lhs, *rhs, condition.type);
+}
+
+bool ASTOptimizer::invariant(AbstractValue &value, LoopHoisting &loop) {
+    auto identifierValue = value.as<IdentifierValue>();
+    if (!identifierValue) return true; // a number
+
+    AbstractIdentifier &identifier = identifierValue->identifier;
+    if (loop.written.count(identifier.name)) return false;
+
+    auto varAccId = identifier.as<VariableAccessIdentifier>();
+    return !varAccId || !loop.written.count(varAccId->accessName);
+}
+
+bool ASTOptimizer::hoistable(AbstractValue &value, LoopHoisting &loop) {
+    auto identifierValue = value.as<IdentifierValue>();
+    bool arrayRead = identifierValue && identifierValue->identifier.kind == VARIABLE_ACCESS_IDENTIFIER_NODE;
+    return invariant(value, loop) && (!arrayRead || loop.everyIteration);
+}
+
+Symbol ASTOptimizer::hoistedTemporary(AbstractExpression &expression, LoopHoisting &loop) {
+    std::string text = expression.toString(0);
+    if (auto binaryExpression = expression.as<BinaryExpression>()) text += std::to_string(binaryExpression->type); // not part of the text
+    auto known = loop.temporaries.find(text);
+    if (known != loop.temporaries.end()) return known->second; // the same expression hoisted before
+
+    Symbol temporary = Symbols::intern("!licm" + std::to_string(hoistedTemporaries.size())); // the lexer never produces a "!"
+    hoistedTemporaries.insert(temporary);
+    originalProgram->declarations.declarations.push_back(new IdentifierDeclaration(temporary));
+
+    loop.preheader.commands.push_back(new Assignment(*new VariableIdentifier(temporary), expression));
+    loop.temporaries[text] = temporary;
+    hoistedInvariants++;
+    return temporary;
+}
+
+void ASTOptimizer::collectWrites(Node *node, std::unordered_set<Symbol> &written) {
+    switch (node->kind) {
+        case COMMAND_LIST_NODE:
+            for (auto const &command : static_cast<CommandList *>(node)->commands) collectWrites(command, written);
+            break;
+        case ASSIGNMENT_NODE:
+            written.insert(static_cast<Assignment *>(node)->identifier.name); // a whole array for a[b]
+            break;
+        case READ_NODE:
+            written.insert(static_cast<Read *>(node)->identifier.name);
+            break;
+        case IF_NODE:
+            collectWrites(&static_cast<If *>(node)->commands, written);
+            break;
+        case IF_ELSE_NODE:
+            collectWrites(&static_cast<IfElse *>(node)->commands, written);
+            collectWrites(&static_cast<IfElse *>(node)->elseCommands, written);
+            break;
+        case WHILE_NODE:
+            collectWrites(&static_cast<While *>(node)->commands, written);
+            break;
+        case FOR_NODE:
+            written.insert(static_cast<For *>(node)->variableName); // changes every iteration and doesn't exist outside the loop
+            collectWrites(&static_cast<For *>(node)->commands, written);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @return True if both values are the same number or read the same
+ * variable or array element.
+ */
+static bool sameValue(AbstractValue &a, AbstractValue &b) {
+    auto aNumber = a.as<NumberValue>();
+    auto bNumber = b.as<NumberValue>();
+    if (aNumber || bNumber) return aNumber && bNumber && aNumber->value == bNumber->value;
+
+    AbstractIdentifier &aIdentifier = static_cast<IdentifierValue &>(a).identifier;
+    AbstractIdentifier &bIdentifier = static_cast<IdentifierValue &>(b).identifier;
+    if (aIdentifier.kind != bIdentifier.kind || aIdentifier.name != bIdentifier.name) return false;
+
+    switch (aIdentifier.kind) {
+        case ACCESS_IDENTIFIER_NODE:
+            return static_cast<AccessIdentifier &>(aIdentifier).index == static_cast<AccessIdentifier &>(bIdentifier).index;
+        case VARIABLE_ACCESS_IDENTIFIER_NODE:
+            return static_cast<VariableAccessIdentifier &>(aIdentifier).accessName == static_cast<VariableAccessIdentifier &>(bIdentifier).accessName;
+        default:
+            return true;
+    }
+}
+
+/**
+ * @return True if the assembler computes the expression with its division
+ * loop rather than with one of its shortcuts (see AbstractAssembler, case
+ * DIVISION): a zero operand, a divisor of 1, -1, 2 or -2, or both operands
+ * in the same cell. Elements a(b), a(c) are never taken for the same cell,
+ * as their addresses are only computed at run time.
+ */
+static bool loopDivision(BinaryExpression &expression) {
+    if (expression.type != DIVISION && expression.type != MODULO) return false;
+
+    auto lhsNumber = expression.lhs.as<NumberValue>();
+    auto rhsNumber = expression.rhs.as<NumberValue>();
+    if (lhsNumber && lhsNumber->value == 0) return false;
+    if (rhsNumber && llabs(rhsNumber->value) <= 2) return false; // 0, +/-1, +/-2
+
+    auto lhsIdentifier = expression.lhs.as<IdentifierValue>();
+    auto rhsIdentifier = expression.rhs.as<IdentifierValue>();
+    bool computedAddress = (lhsIdentifier && lhsIdentifier->identifier.kind == VARIABLE_ACCESS_IDENTIFIER_NODE)
+                           || (rhsIdentifier && rhsIdentifier->identifier.kind == VARIABLE_ACCESS_IDENTIFIER_NODE);
+    return computedAddress || !sameValue(expression.lhs, expression.rhs);
+}
+
+/**
+ * @return True if a write of any of the names may change the value.
+ */
+static bool readsAny(AbstractValue &value, std::unordered_set<Symbol> &names) {
+    auto identifierValue = value.as<IdentifierValue>();
+    if (!identifierValue) return false;
+
+    AbstractIdentifier &identifier = identifierValue->identifier;
+    auto varAccId = identifier.as<VariableAccessIdentifier>();
+    return names.count(identifier.name) || (varAccId && names.count(varAccId->accessName));
+}
+
+void ASTOptimizer::fuseDivisions(CommandList &commandList) {
+    auto &commands = commandList.commands;
+
+    for (size_t i = 0; i < commands.size(); i++) {
+        switch (commands[i]->kind) {
+            case COMMAND_LIST_NODE:
+                fuseDivisions(*static_cast<CommandList *>(commands[i]));
+                continue;
+            case IF_NODE:
+                fuseDivisions(static_cast<If *>(commands[i])->commands);
+                continue;
+            case IF_ELSE_NODE:
+                fuseDivisions(static_cast<IfElse *>(commands[i])->commands);
+                fuseDivisions(static_cast<IfElse *>(commands[i])->elseCommands);
+                continue;
+            case WHILE_NODE:
+                fuseDivisions(static_cast<While *>(commands[i])->commands);
+                continue;
+            case FOR_NODE:
+                fuseDivisions(static_cast<For *>(commands[i])->commands);
+                continue;
+            case ASSIGNMENT_NODE:
+                break;
+            default:
+                continue;
+        }
+
+        auto division = static_cast<Assignment *>(commands[i])->expression.as<BinaryExpression>();
+        if (!division || division->companion || !loopDivision(*division)) continue;
+
+        std::unordered_set<Symbol> written;
+        collectWrites(commands[i], written); // e.g. a ASSIGN a DIV b; r ASSIGN a MOD b
+
+        for (size_t j = i + 1; j < commands.size() && !readsAny(division->lhs, written) && !readsAny(division->rhs, written); j++) {
+            auto assignNode = commands[j]->as<Assignment>();
+            auto other = assignNode ? assignNode->expression.as<BinaryExpression>() : nullptr;
+
+            if (other && other->type == (division->type == DIVISION ? MODULO : DIVISION)
+                && sameValue(division->lhs, other->lhs) && sameValue(division->rhs, other->rhs)) {
+                Symbol temporary = Symbols::intern("!div" + std::to_string(fusedDivisions++)); // the lexer never produces a "!"
+                originalProgram->declarations.declarations.push_back(new IdentifierDeclaration(temporary));
+
+                auto fused = new BinaryExpression(division->lhs, division->rhs, division->type);
+                fused->companion = new VariableIdentifier(temporary);
+                commands[i] = new Assignment(static_cast<Assignment *>(commands[i])->identifier, *fused);
+                commands[j] = new Assignment(assignNode->identifier, *new UnaryExpression(*new IdentifierValue(*new VariableIdentifier(temporary))));
+                break;
+            }
+
+            collectWrites(commands[j], written);
+        }
+    }
+}
+
 void ASTOptimizer::optimize(bool verbose) {
-    while (traverse(originalProgram->commands, [this](Node *node) -> Node * { return constantConditionRemover(node); })) {
-        std::cout << "   [i] flattening always true expressions" << std::endl;
+    rules.clear();
+    addRule("flattening always true expressions", [this](Node *node) -> Node * { return constantConditionRemover(node); });
+    addRule("unrolling constant loops", [this](Node *node) -> Node * { return constantLoopUnroller(node); });
+    addRule("replacing constant expressions", [this](Node *node) -> Node * { return constantExpressionOptimizer(node); });
+
+    {
+        Phase phase("ast rewriting");
+        rewrite(originalProgram->commands);
     }
 
-    while (traverse(originalProgram->commands, [this](Node *node) -> Node * { return constantLoopUnroller(node); })) {
-        std::cout << "   [i] unrolling constant loops" << std::endl;
+    {
+        Phase phase("value propagation");
+        propagateValues();
     }
-    while (traverse(originalProgram->commands, [this](Node *node) -> Node * { return constantExpressionOptimizer(node); })) {
-        std::cout << "   [i] Replacing constant expressions" << std::endl;
+
+    if (propagatedValues || deadBranches) { // fold what became constant, unroll loops with bounds which did
+        Phase phase("ast rewriting");
+        rewrite(originalProgram->commands);
+    }
+
+    {
+        Phase phase("loop invariant code motion");
+        hoistInvariants(originalProgram->commands);
     }
-}
\ No newline at end of file
+
+    {
+        Phase phase("division fusion");
+        fuseDivisions(originalProgram->commands);
+    }
+
+    for (auto const &rule : rules) {
+        if (rule.applied) Diagnostics::out() << "   [i] " << rule.description << " (" << rule.applied << "x)" << std::endl;
+        Stats::count(rule.description.c_str(), rule.applied);
+    }
+
+    if (propagatedValues) Diagnostics::out() << "   [i] propagating known values (" << propagatedValues << "x)" << std::endl;
+    if (deadBranches) Diagnostics::out() << "   [i] removing branches never taken (" << deadBranches << "x)" << std::endl;
+    Stats::count("propagated values", propagatedValues);
+    Stats::count("dead branches", deadBranches);
+
+    if (hoistedInvariants) Diagnostics::out() << "   [i] hoisting loop invariants (" << hoistedInvariants << "x)" << std::endl;
+    Stats::count("hoisted invariants", hoistedInvariants);
+
+    if (fusedDivisions) Diagnostics::out() << "   [i] fusing divisions (" << fusedDivisions << "x)" << std::endl;
+    Stats::count("fused divisions", fusedDivisions);
+}
@@ -1,38 +1,130 @@
 #include "../../front/ast/node.h"
+#include "../../driver/Diagnostics.h"
+#include "../../driver/Stats.h"
 #include <math.h>
 #include <functional>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #ifndef COMPILER_ASTOPTIMIZER_H
 #define COMPILER_ASTOPTIMIZER_H
 
+/**
+ * A single rewrite rule of the ASTOptimizer.
+ */
+struct RewriteRule {
+    std::string description;
+
+    /**
+     * Returns the very node it was given if the rule doesn't apply to it.
+     */
+    Callback rewrite;
+
+    long long applied;
+};
+
+enum KnownValueState {
+    UNKNOWN_VALUE,
+    CONSTANT_VALUE,
+    COPIED_VALUE
+};
+
+/**
+ * What value propagation knows about a scalar variable: nothing, its
+ * value, or another variable it holds a copy of. A copy is only valid as
+ * long as the source wasn't written since, i.e. while the source's version
+ * is still the one recorded here.
+ */
+struct KnownValue {
+    KnownValueState state = UNKNOWN_VALUE;
+    long long value = 0;
+    int source = -1;
+    long long sourceVersion = 0;
+};
+
+/**
+ * Knowledge about every scalar variable at some point of the program,
+ * indexed by the variable's slot (see ASTOptimizer::slots). Every write
+ * of a variable gives it a new, program-wide unique version.
+ */
+struct KnownValues {
+    std::vector<KnownValue> values;
+    std::vector<long long> versions;
+};
+
+/**
+ * State of hoisting invariants out of a single loop.
+ */
+struct LoopHoisting {
+    /**
+     * Variables and arrays written anywhere in the loop, including the
+     * iterators of the loop and of the loops nested in it.
+     */
+    std::unordered_set<Symbol> written;
+
+    /**
+     * Commands to run before the loop.
+     */
+    CommandList &preheader;
+
+    /**
+     * Temporary already holding an expression, by the expression's text.
+     */
+    std::unordered_map<std::string, Symbol> temporaries;
+
+    /**
+     * True while walking commands run on every iteration of a loop which
+     * runs at least once; only there may a[b] be read ahead of the loop,
+     * as an index out of the array's range stops the vm.
+     */
+    bool everyIteration = false;
+
+    LoopHoisting(CommandList &preheader) : preheader(preheader) {}
+};
+
 /**
  * High abstraction class for AST optimizations, based
  * on callback functions and recursive replacer-copying
  * mechanism (implemented in ast node definitions).
+ * All rules are applied together in a single bottom-up walk: a node
+ * is rewritten once its commands are, and whatever a rule replaces it
+ * with is walked again, so e.g. conditions exposed by unrolling a loop
+ * are removed as well. A replacement made of the node's own commands
+ * (e.g. the body of an IF which always holds) is already rewritten, so
+ * it isn't walked again; nodes left unchanged are never visited twice.
  */
 class ASTOptimizer {
 private:
     Program *originalProgram;
 
+    std::vector<RewriteRule> rules;
+
+    void addRule(std::string description, Callback rule);
+
     /**
-     * Traverses programs nodes, calling traverse on every command in node's
-     * command list (if it has any).
-     * @param node Node to be traversed.
-     * @param callback Callback used with called traverse.
-     * @return True if any element was changed, false otherwise.
+     * @return Replacement given by the first rule which applied to the
+     * node; the node itself if none did.
      */
-    bool traverse(Node *node, Callback callback);
+    Node *applyRules(Node *node);
 
     /**
-     * Calls callback on each command on the list and changes the
-     * command on the list if the callback returned something else
-     * that the original command.
-     * @param commandList Commands to be traversed.
-     * @param callback Callback which is called on each command.
-     * @return True if any element was changed, false otherwise.
+     * Rewrites every command on the list in place.
+     * @param commandList Commands to be rewritten.
      */
-    bool traverse(CommandList &commandList, Callback callback);
+    void rewrite(CommandList &commandList);
+
+    /**
+     * Rewrites node's commands (if it has any) and then the node itself,
+     * until no rule applies anymore.
+     * @param node Node to be rewritten.
+     * @return The node or its replacement.
+     */
+    Node *rewrite(Node *node);
+
+    void rewriteChildren(Node *node);
 
     /**
      * Creates an UnaryExpression for every BinaryExpression
@@ -45,11 +137,28 @@ private:
      */
     Node *constantExpressionOptimizer(Node *node);
 
+    /**
+     * Maximum number of instructions (as guessed by estimateSize) a
+     * single loop may be unrolled into.
+     */
+    long long unrollBudget;
+
+    /**
+     * Roughly estimates the number of asm instructions generated for
+     * a node.
+     */
+    long long estimateSize(Node *node);
+
     /**
      * Creates a command list node for every for loop
      * with iteration start and end is a constant value, repeating
      * commands in the loop with iterator changed to incremented
      * values.
+     * Loops which wouldn't fit in the unroll budget are unrolled
+     * partially: the loop itself repeats its commands up to
+     * MAX_UNROLL_FACTOR times per iteration check and the remaining
+     * iterations are unrolled after it. If even that doesn't fit, the
+     * loop stays as it is.
      * @param node Node to be checked.
      * @return Original node if it wasn't a for loop with
      * constant start and end value; unrolled loop as a
@@ -57,6 +166,16 @@ private:
      */
     Node *constantLoopUnroller(Node *node);
 
+    /**
+     * Appends loop's commands with the iterator replaced by consecutive
+     * values.
+     * @param commandList List to append the copies to.
+     * @param forNode Unrolled loop.
+     * @param from Iterator value in the first copy.
+     * @param count Number of copies.
+     */
+    void unrollIterations(CommandList &commandList, For &forNode, long long from, long long count);
+
     /**
      * Searches for condtions which always hold or always fail
      * and removes them/warns about them
@@ -71,16 +190,167 @@ private:
      * variable by a number value, e.g.
      * a ASSIGN i PLUS 1 ==> a ASSIGN 10 PLUS 1
      * a[i] ASSIGN 0 ==> a[10] ASSIGN 0
-     * @param variableToReplace Name of the iterator value to look for.
+     * @param variableToReplace Symbol of the iterator value to look for.
      * @param value A numeric value to replace it to.
      * @return Original node if it doesn't use the specifier variable
      * name anywhere; node with name replaced to the numeric value
      * everywhere otherwise.
      */
-    Callback iteratorReplacer(std::string &variableToReplace, long long value);
+    Callback iteratorReplacer(Symbol variableToReplace, long long value);
+
+    /**
+     * Slot of every declared scalar variable by its symbol, -1 for
+     * anything else (arrays, iterators, undeclared names).
+     */
+    std::vector<int> slots;
+
+    int slot(Symbol name) { return name < slots.size() ? slots[name] : -1; }
+
+    /**
+     * Symbol of every slot.
+     */
+    std::vector<Symbol> scalars;
+
+    long long lastVersion = 0;
+
+    long long propagatedValues = 0;
+
+    long long deadBranches = 0;
+
+    /**
+     * Propagates known values and copies of scalar variables forward
+     * through the whole program, e.g.
+     * n ASSIGN 23; ... w ASSIGN w MOD n ==> n ASSIGN 23; ... w ASSIGN w MOD 23
+     * and folds expressions and conditions which become constant. Branches
+     * never taken are removed, so whatever they assign doesn't spoil the
+     * values known after them. Variables written anywhere in a loop are
+     * unknown in the whole loop and after it.
+     */
+    void propagateValues();
+
+    void propagate(CommandList &commandList, KnownValues &known);
+
+    /**
+     * @return The command with known values substituted (possibly a new
+     * node), a list of the commands of its only live branch or an empty
+     * list if it never runs.
+     */
+    Node *propagate(Node *node, KnownValues &known);
+
+    /**
+     * @return A valid value or copy known for the variable; nullptr if
+     * nothing is known about it.
+     */
+    const KnownValue *knownValue(KnownValues &known, Symbol name);
+
+    /**
+     * @return The value with a known variable replaced by its value or
+     * its copy source; the value itself if nothing is known.
+     */
+    AbstractValue *substitute(AbstractValue &value, KnownValues &known);
+
+    /**
+     * @return The identifier with a known array index variable replaced;
+     * the identifier itself if it has none or nothing is known about it.
+     */
+    AbstractIdentifier *substitute(AbstractIdentifier &identifier, KnownValues &known);
+
+    Condition *substitute(Condition &condition, KnownValues &known);
+
+    /**
+     * Records a write of an (already substituted) expression to a variable.
+     */
+    void assign(KnownValues &known, int target, AbstractExpression *expression);
+
+    /**
+     * Forgets everything about the variables assigned or read anywhere in
+     * the node.
+     */
+    void forgetWrites(Node *node, KnownValues &known);
+
+    /**
+     * Leaves in known only what is known on both paths joining.
+     */
+    void merge(KnownValues &known, KnownValues &other);
+
+    /**
+     * Hidden variables holding hoisted values; a single assignment
+     * defines each of them.
+     */
+    std::unordered_set<Symbol> hoistedTemporaries;
+
+    long long hoistedInvariants = 0;
+
+    /**
+     * Loop-invariant code motion: moves expressions whose operands no
+     * loop iteration writes in front of the loop, into hidden variables, e.g.
+     * WHILE ... DO x ASSIGN a TIMES b; ... ==> !licm0 ASSIGN a TIMES b; WHILE ... DO x ASSIGN !licm0; ...
+     * Inner loops go first; whatever they hoisted may then leave the outer
+     * loop too. Arithmetic has no side effects, so evaluating it before a
+     * loop which never runs it is only a matter of cost; a read of a[b]
+     * (also as an operand) stops the vm if b is out of a's range, so it is
+     * hoisted only if the loop surely runs it (see LoopHoisting::everyIteration).
+     * @param commandList Commands whose loops are to be processed.
+     */
+    void hoistInvariants(CommandList &commandList);
+
+    /**
+     * Hoists invariants out of a single loop.
+     * @param loop Loop node; replaced if its condition changed.
+     * @return Commands to be run before the loop (possibly none).
+     */
+    CommandList *hoistInvariants(Node *&loop);
+
+    void hoistInvariants(CommandList &commandList, LoopHoisting &loop);
+
+    /**
+     * Hoists out of commands which may not run on every iteration.
+     */
+    void hoistConditionally(CommandList &commandList, LoopHoisting &loop);
+
+    void hoist(Node *&command, LoopHoisting &loop);
+
+    AbstractExpression *hoist(AbstractExpression &expression, LoopHoisting &loop);
+
+    AbstractValue *hoist(AbstractValue &value, LoopHoisting &loop);
+
+    Condition *hoist(Condition &condition, LoopHoisting &loop);
+
+    bool invariant(AbstractValue &value, LoopHoisting &loop);
+
+    /**
+     * @return True if the value is invariant and may be evaluated before the loop.
+     */
+    bool hoistable(AbstractValue &value, LoopHoisting &loop);
+
+    /**
+     * @return A hidden variable assigned the expression in the loop's preheader.
+     */
+    Symbol hoistedTemporary(AbstractExpression &expression, LoopHoisting &loop);
+
+    /**
+     * Adds names of the variables and arrays written in the node.
+     */
+    void collectWrites(Node *node, std::unordered_set<Symbol> &written);
+
+    long long fusedDivisions = 0;
+
+    /**
+     * Lets a DIV and a MOD of the same operands share a single division,
+     * if nothing between them on a command list writes the operands, e.g.
+     * q ASSIGN a DIV b; ... r ASSIGN a MOD b ==> q ASSIGN a DIV b (remainder into !div0); ... r ASSIGN !div0
+     * Divisions the assembler does without its division loop (of equal
+     * values, by 0, 1 or 2...) are left alone, as they are cheaper twice.
+     * @param commandList Commands to be searched, along with nested ones.
+     */
+    void fuseDivisions(CommandList &commandList);
 
 public:
-    ASTOptimizer(Program *program) : originalProgram(program) {}
+    static const long long DEFAULT_UNROLL_BUDGET = 50000;
+    static const long long MAX_UNROLL_FACTOR = 8;
+
+    ASTOptimizer(Program *program, long long unrollBudget = DEFAULT_UNROLL_BUDGET)
+            : originalProgram(program), unrollBudget(unrollBudget) {}
 
     void optimize(bool verbose);
 };
@@ -0,0 +1,244 @@
+#include "ControlFlowGraph.h"
+#include <algorithm>
+#include <utility>
+
+ControlFlowGraph::ControlFlowGraph(InstructionList &instructions) : instructions(instructions) {
+    buildBlocks();
+    computeOrder();
+    computeDominators();
+    findLoops();
+}
+
+ControlFlowGraph::~ControlFlowGraph() {
+    for (const auto &block : blocks) {
+        delete block;
+    }
+    for (const auto &loop : loops) {
+        delete loop;
+    }
+}
+
+static void addEdge(BasicBlock *from, BasicBlock *to) {
+    if (std::find(from->successors.begin(), from->successors.end(), to) != from->successors.end()) return;
+    from->successors.push_back(to);
+    to->predecessors.push_back(from);
+}
+
+void ControlFlowGraph::buildBlocks() {
+    instructions.seal(false); // real instructions get consecutive addresses, which index the tables below
+
+    long long size = 0;
+    for (auto const &ins : instructions.getInstructions()) {
+        if (!ins->stub) size = ins->getAddress() + 1;
+    }
+
+    std::vector<bool> targets(size + 1, false); // a jump past the very end targets address size
+    for (auto const &ins : instructions.getInstructions()) {
+        if (auto jumpInstruction = dynamic_cast<Jump *>(ins)) {
+            Instruction *target = jumpInstruction->target;
+            while (target && target->stub) {
+                target = target->next;
+            }
+            if (target) jumpInstruction->target = target; // a jump past the very end keeps its Stub
+
+            targets[jumpInstruction->target->getAddress()] = true;
+        }
+    }
+
+    std::vector<BasicBlock *> blockByLeader(size + 1, nullptr);
+    BasicBlock *current = nullptr;
+    bool ended = true;
+
+    for (auto const &ins : instructions.getInstructions()) {
+        if (ins->stub) continue;
+
+        if (ended || targets[ins->getAddress()]) {
+            current = new BasicBlock(blocks.size(), ins);
+            blocks.push_back(current);
+            blockByLeader[ins->getAddress()] = current;
+        } else {
+            current->last = ins;
+        }
+
+        ended = dynamic_cast<Jump *>(ins) || dynamic_cast<Halt *>(ins);
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BasicBlock *block = blocks[i];
+        auto jumpInstruction = dynamic_cast<Jump *>(block->last);
+
+        bool fallsThrough = !dynamic_cast<Halt *>(block->last) && (!jumpInstruction || jumpInstruction->conditional());
+        if (fallsThrough && i + 1 < blocks.size()) {
+            block->fallthrough = blocks[i + 1];
+            addEdge(block, block->fallthrough);
+        }
+
+        if (jumpInstruction) {
+            BasicBlock *target = blockByLeader[jumpInstruction->target->getAddress()];
+            if (target) addEdge(block, target);
+        }
+    }
+}
+
+void ControlFlowGraph::computeOrder() {
+    if (blocks.empty()) return;
+
+    std::vector<BasicBlock *> postorder;
+    std::vector<bool> visited(blocks.size(), false);
+    std::vector<std::pair<BasicBlock *, size_t>> stack; // a block and the index of its next successor to visit
+
+    stack.emplace_back(blocks[0], 0);
+    visited[0] = true;
+    while (!stack.empty()) {
+        BasicBlock *block = stack.back().first;
+        size_t &next = stack.back().second;
+
+        if (next < block->successors.size()) {
+            BasicBlock *successor = block->successors[next++];
+            if (!visited[successor->id]) {
+                visited[successor->id] = true;
+                stack.emplace_back(successor, 0);
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    reversePostorder.assign(postorder.rbegin(), postorder.rend());
+    for (size_t i = 0; i < reversePostorder.size(); i++) {
+        reversePostorder[i]->order = i;
+    }
+}
+
+void ControlFlowGraph::computeDominators() {
+    if (reversePostorder.empty()) return;
+
+    BasicBlock *entry = reversePostorder[0];
+    entry->immediateDominator = entry; // temporarily, so that walks up the tree stop at the entry
+
+    auto intersect = [](BasicBlock *a, BasicBlock *b) {
+        while (a != b) {
+            while (a->order > b->order) a = a->immediateDominator;
+            while (b->order > a->order) b = b->immediateDominator;
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < reversePostorder.size(); i++) {
+            BasicBlock *block = reversePostorder[i];
+
+            BasicBlock *dominator = nullptr;
+            for (const auto &predecessor : block->predecessors) {
+                if (!predecessor->immediateDominator) continue; // not processed yet (or unreachable)
+                dominator = dominator ? intersect(predecessor, dominator) : predecessor;
+            }
+
+            if (dominator != block->immediateDominator) {
+                block->immediateDominator = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    entry->immediateDominator = nullptr;
+
+    // number the dominator tree, children being visited in the reverse postorder
+    std::vector<std::vector<BasicBlock *>> children(blocks.size());
+    for (size_t i = 1; i < reversePostorder.size(); i++) {
+        children[reversePostorder[i]->immediateDominator->id].push_back(reversePostorder[i]);
+    }
+
+    int time = 0;
+    std::vector<std::pair<BasicBlock *, size_t>> stack;
+    stack.emplace_back(entry, 0);
+    entry->dominatorTreeIn = time++;
+    while (!stack.empty()) {
+        BasicBlock *block = stack.back().first;
+        size_t &next = stack.back().second;
+
+        if (next < children[block->id].size()) {
+            BasicBlock *child = children[block->id][next++];
+            child->dominatorTreeIn = time++;
+            stack.emplace_back(child, 0);
+        } else {
+            block->dominatorTreeOut = time++;
+            stack.pop_back();
+        }
+    }
+}
+
+bool ControlFlowGraph::dominates(BasicBlock *a, BasicBlock *b) {
+    if (!a->reachable() || !b->reachable()) return false;
+    return a->dominatorTreeIn <= b->dominatorTreeIn && b->dominatorTreeOut <= a->dominatorTreeOut;
+}
+
+void ControlFlowGraph::findLoops() {
+    std::vector<Loop *> loopByHeader(blocks.size(), nullptr);
+    std::vector<Loop *> mark(blocks.size(), nullptr); // loop a block was last added to
+    std::vector<BasicBlock *> worklist;
+
+    for (const auto &block : reversePostorder) {
+        for (const auto &successor : block->successors) {
+            if (!dominates(successor, block)) continue; // not a back edge
+
+            Loop *&loop = loopByHeader[successor->id];
+            if (!loop) {
+                loop = new Loop();
+                loop->header = successor;
+                loop->blocks.push_back(successor);
+                mark[successor->id] = loop;
+                loops.push_back(loop);
+            }
+
+            worklist.push_back(block);
+            while (!worklist.empty()) {
+                BasicBlock *member = worklist.back();
+                worklist.pop_back();
+                if (mark[member->id] == loop) continue;
+
+                mark[member->id] = loop;
+                loop->blocks.push_back(member);
+                for (const auto &predecessor : member->predecessors) {
+                    if (predecessor->reachable() && mark[predecessor->id] != loop) worklist.push_back(predecessor);
+                }
+            }
+        }
+    }
+
+    // a loop nested in another one is strictly smaller than it
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop *a, const Loop *b) {
+        return a->blocks.size() > b->blocks.size();
+    });
+
+    for (const auto &loop : loops) {
+        BasicBlock *enclosing = loop->header->loopHeader;
+        loop->parent = enclosing ? loopByHeader[enclosing->id] : nullptr;
+
+        for (const auto &member : loop->blocks) {
+            member->loopHeader = loop->header;
+            member->loopDepth++;
+        }
+    }
+}
+
+void ControlFlowGraph::relink() {
+    std::vector<Instruction *> sequence;
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BasicBlock *block = blocks[i];
+        for (Instruction *ins = block->first;; ins = ins->next) {
+            if (!ins->stub) sequence.push_back(ins);
+            if (ins == block->last) break;
+        }
+
+        if (block->fallthrough && (i + 1 == blocks.size() || blocks[i + 1] != block->fallthrough)) {
+            sequence.push_back(new Jump(block->fallthrough->first));
+        }
+    }
+
+    instructions.relink(sequence);
+}
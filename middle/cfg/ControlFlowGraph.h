@@ -0,0 +1,143 @@
+#include "../../back/asm/asm.h"
+#include "../../back/asm/InstructionList.h"
+#include <vector>
+
+#ifndef COMPILER_CONTROLFLOWGRAPH_H
+#define COMPILER_CONTROLFLOWGRAPH_H
+
+/**
+ * A maximal run of instructions entered only at its first one and left
+ * only after its last one. Stubs are never part of a block.
+ */
+class BasicBlock {
+public:
+    /**
+     * Index in ControlFlowGraph::blocks.
+     */
+    int id;
+
+    Instruction *first;
+    Instruction *last;
+
+    std::vector<BasicBlock *> predecessors;
+    std::vector<BasicBlock *> successors;
+
+    /**
+     * Position in the reverse postorder, or -1 if the block can't be
+     * reached from the entry.
+     */
+    int order = -1;
+
+    /**
+     * Nullptr for the entry and for unreachable blocks.
+     */
+    BasicBlock *immediateDominator = nullptr;
+
+    /**
+     * Header of the innermost loop containing the block, or nullptr.
+     */
+    BasicBlock *loopHeader = nullptr;
+
+    /**
+     * Number of loops containing the block; 0 outside of any loop.
+     */
+    int loopDepth = 0;
+
+    /**
+     * Successor reached by not jumping (the block after this one on the
+     * list), or nullptr if the block always jumps or halts.
+     */
+    BasicBlock *fallthrough = nullptr;
+
+    /**
+     * Entry and exit times of a depth-first walk of the dominator tree,
+     * making dominance checks constant-time.
+     */
+    int dominatorTreeIn = -1;
+    int dominatorTreeOut = -1;
+
+    bool reachable() const { return order >= 0; }
+
+    BasicBlock(int id, Instruction *first) : id(id), first(first), last(first) {}
+};
+
+/**
+ * A natural loop: the header and every block which can reach a back
+ * edge to the header without going through it. Loops sharing a header
+ * are merged.
+ */
+struct Loop {
+    BasicBlock *header;
+    std::vector<BasicBlock *> blocks;
+
+    /**
+     * Innermost loop containing this one, or nullptr.
+     */
+    Loop *parent = nullptr;
+};
+
+/**
+ * Basic blocks of an InstructionList with the edges between them, the
+ * dominator tree and the loop nesting; every part is computed in about
+ * linear time, so the graph may be rebuilt after each change to the code.
+ *
+ * Building the graph seals the list (the blocks are found by addresses)
+ * and moves every jump's target from a Stub onto the first real
+ * instruction after it, so that blocks can be laid out anew (see relink)
+ * without the Stubs.
+ */
+class ControlFlowGraph {
+private:
+    InstructionList &instructions;
+
+    void buildBlocks();
+
+    void computeOrder();
+
+    /**
+     * Cooper, Harvey and Kennedy's "A Simple, Fast Dominance Algorithm".
+     */
+    void computeDominators();
+
+    void findLoops();
+
+public:
+    /**
+     * Blocks in the order of the instruction list; the first one is the entry.
+     */
+    std::vector<BasicBlock *> blocks;
+
+    /**
+     * Reachable blocks, each after all of its predecessors but the ones
+     * reaching it by back edges.
+     */
+    std::vector<BasicBlock *> reversePostorder;
+
+    /**
+     * Loops, outer ones before the ones nested in them.
+     */
+    std::vector<Loop *> loops;
+
+    /**
+     * @return True if every path from the entry to b goes through a.
+     */
+    bool dominates(BasicBlock *a, BasicBlock *b);
+
+    /**
+     * Writes the blocks back to the instruction list in the order of the
+     * blocks vector, which may be reordered or have blocks dropped, adding
+     * JUMPs where a block no longer falls through to its successor. The
+     * graph shouldn't be used afterwards.
+     */
+    void relink();
+
+    ControlFlowGraph(InstructionList &instructions);
+
+    ControlFlowGraph(const ControlFlowGraph &) = delete;
+
+    ControlFlowGraph &operator=(const ControlFlowGraph &) = delete;
+
+    ~ControlFlowGraph();
+};
+
+#endif //COMPILER_CONTROLFLOWGRAPH_H
@@ -1,85 +1,353 @@
 #include "PeepholeOptimizer.h"
+#include <algorithm>
+#include <unordered_set>
 
 void PeepholeOptimizer::optimize(bool verbose) {
-    std::cout << "   [i] Removing useless STORE LOADs..." << std::endl;
-    while (removeUselessStoreLoads()) {
-        if (verbose) std::cout << std::endl << "Removed useless STORE LOAD";
+    this->verbose = verbose;
+
+    Diagnostics::out() << "   [i] Removing unreachable code..." << std::endl;
+    long long removed;
+    {
+        Phase phase("unreachable code removal");
+        removed = removeUnreachableCode();
+    }
+    if (verbose) Diagnostics::out() << "   [i] removed " << removed << std::endl;
+    Stats::count("removed unreachable instructions", removed);
+
+    Diagnostics::out() << "   [i] Removing redundant LOADs..." << std::endl;
+    {
+        Phase phase("redundant load removal");
+        removed = removeRedundantLoads();
     }
-    std::cout << "   [i] Removing useless STORE LOADIs..." << std::endl;
-    while (removeUselessStoreLoadis()) {
-        if (verbose) std::cout << std::endl << "Removed useless STORE LOADI";
+    if (verbose) Diagnostics::out() << "   [i] removed " << removed << std::endl;
+    Stats::count("removed redundant LOADs", removed);
+
+    Diagnostics::out() << "   [i] Removing dead STOREs..." << std::endl;
+    {
+        Phase phase("dead store removal");
+        removed = removeDeadStores();
     }
+    if (verbose) Diagnostics::out() << "   [i] removed " << removed << std::endl;
+    Stats::count("removed dead STOREs", removed);
+
+    indexJumps();
+
+    Diagnostics::out() << "   [i] Removing useless STORE LOADIs..." << std::endl;
+    {
+        Phase phase("store-loadi removal");
+        removed = removeUselessStoreLoadis();
+    }
+    if (verbose) Diagnostics::out() << "   [i] removed " << removed << std::endl;
+    Stats::count("removed STORE LOADIs", removed);
 }
 
-bool PeepholeOptimizer::removeUselessStoreLoads() {
-    for (int i = 0; i < instructions.getInstructions().size(); i++) {
-        if (auto storeInstruction = dynamic_cast<Store *>(instructions.getInstructions()[i])) {
+void PeepholeOptimizer::indexJumps() {
+    jumpsByTarget.clear();
 
-            int offsetToNonStub = 0;
-            while (dynamic_cast<Stub *>(instructions.getInstructions()[++offsetToNonStub + i])) {
-                if (i + offsetToNonStub == instructions.getInstructions().size()) return false;
-            }
+    for (auto const &ins : instructions.getInstructions()) {
+        if (auto jumpInstruction = dynamic_cast<Jump *>(ins)) {
+            jumpsByTarget[jumpInstruction->target->getAddress()].push_back(jumpInstruction);
+        }
+    }
+}
 
-            if (auto loadInstruction = dynamic_cast<Load *>(instructions.getInstructions()[i + offsetToNonStub])) {
-                if (storeInstruction->address.getAddress() == loadInstruction->address.getAddress()) {
+bool PeepholeOptimizer::isJumpTarget(Instruction *instruction) {
+    return jumpsByTarget.count(instruction->getAddress()) > 0;
+}
 
-                    bool canRemove = true;
-                    for (int j = 0; j < instructions.getInstructions().size(); j++) {
-                        if (auto jumpInstruction = dynamic_cast<Jump *>(instructions.getInstructions()[j])) {
-                            if (jumpInstruction->target->getAddress() == loadInstruction->getAddress()) {
-                                canRemove = false;
-                                break;
-                            }
-                        }
-                    }
+Instruction *PeepholeOptimizer::nextNonStub(Instruction *instruction) {
+    Instruction *nonStub = instruction->next;
+    while (nonStub && nonStub->stub) {
+        nonStub = nonStub->next;
+    }
+    return nonStub;
+}
 
-                    if (canRemove) {
-                        instructions.getInstructions().erase(instructions.getInstructions().begin() + i + offsetToNonStub);
+Instruction *PeepholeOptimizer::previousNonStub(Instruction *instruction) {
+    Instruction *nonStub = instruction->previous;
+    while (nonStub && nonStub->stub) {
+        nonStub = nonStub->previous;
+    }
+    return nonStub;
+}
 
-                        return true;
-                    }
-                }
+long long PeepholeOptimizer::removeUnreachableCode() {
+    ControlFlowGraph graph(instructions);
+    Stats::set("basic blocks", graph.blocks.size());
+    Stats::set("loops", graph.loops.size());
+
+    long long removed = 0;
+    auto unreachable = std::remove_if(graph.blocks.begin(), graph.blocks.end(), [&removed](BasicBlock *block) {
+        if (block->reachable()) return false;
+        for (Instruction *ins = block->first;; ins = ins->next) {
+            if (!ins->stub) removed++;
+            if (ins == block->last) break;
+        }
+        delete block;
+        return true;
+    });
+    if (removed == 0) return 0;
+
+    graph.blocks.erase(unreachable, graph.blocks.end());
+    graph.relink();
+    instructions.seal(false);
+    return removed;
+}
+
+void PeepholeOptimizer::trackAccumulator(Instruction *instruction, std::vector<long long> &knownCells) {
+    if (auto loadInstruction = dynamic_cast<Load *>(instruction)) {
+        long long cell = loadInstruction->address.getAddress();
+        if (!std::binary_search(knownCells.begin(), knownCells.end(), cell)) knownCells.assign(1, cell);
+
+    } else if (auto storeInstruction = dynamic_cast<Store *>(instruction)) {
+        long long cell = storeInstruction->address.getAddress();
+        auto position = std::lower_bound(knownCells.begin(), knownCells.end(), cell);
+        if (position == knownCells.end() || *position != cell) knownCells.insert(position, cell);
+
+    } else if (dynamic_cast<Storei *>(instruction) || dynamic_cast<Put *>(instruction) || dynamic_cast<Jump *>(instruction)) {
+        // the accumulator stays, and whichever cell STOREI writes gets its value
+    } else {
+        knownCells.clear();
+    }
+}
+
+long long PeepholeOptimizer::removeRedundantLoads() {
+    ControlFlowGraph graph(instructions);
+
+    std::vector<std::vector<long long>> exitCells(graph.blocks.size());
+    std::vector<bool> visited(graph.blocks.size(), false); // blocks not visited yet don't restrict their successors
+
+    auto entryCells = [&](BasicBlock *block) {
+        std::vector<long long> cells, common;
+        bool first = true;
+        if (block->order == 0) return cells; // nothing is known at the start
+
+        for (const auto &predecessor : block->predecessors) {
+            if (!visited[predecessor->id]) continue;
+            if (first) {
+                cells = exitCells[predecessor->id];
+                first = false;
+            } else {
+                common.clear();
+                std::set_intersection(cells.begin(), cells.end(), exitCells[predecessor->id].begin(),
+                                      exitCells[predecessor->id].end(), std::back_inserter(common));
+                cells.swap(common);
+            }
+        }
+        return cells;
+    };
+
+    bool changed = true;
+    while (changed) { // the sets only shrink, so this settles
+        changed = false;
+        for (const auto &block : graph.reversePostorder) {
+            std::vector<long long> cells = entryCells(block);
+            for (Instruction *ins = block->first;; ins = ins->next) {
+                if (!ins->stub) trackAccumulator(ins, cells);
+                if (ins == block->last) break;
             }
+
+            if (!visited[block->id] || cells != exitCells[block->id]) {
+                visited[block->id] = true;
+                exitCells[block->id].swap(cells);
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<Instruction *> redundant;
+    for (const auto &block : graph.reversePostorder) {
+        std::vector<long long> cells = entryCells(block);
+        for (Instruction *ins = block->first;; ins = ins->next) {
+            auto loadInstruction = dynamic_cast<Load *>(ins);
+            if (loadInstruction && std::binary_search(cells.begin(), cells.end(), loadInstruction->address.getAddress())) {
+                redundant.push_back(loadInstruction); // the accumulator doesn't change, nor does the knowledge
+            } else if (!ins->stub) {
+                trackAccumulator(ins, cells);
+            }
+            if (ins == block->last) break;
         }
     }
 
-    return false;
+    removeAll(redundant);
+    if (verbose) {
+        for (size_t i = 0; i < redundant.size(); i++) Diagnostics::out() << std::endl << "Removed redundant LOAD";
+    }
+
+    return redundant.size();
 }
 
-bool PeepholeOptimizer::removeUselessStoreLoadis() {
-    for (int i = 0; i < instructions.getInstructions().size(); i++) {
-        if (auto storeInstruction = dynamic_cast<Store *>(instructions.getInstructions()[i])) {
+void PeepholeOptimizer::removeAll(const std::vector<Instruction *> &removals) {
+    std::unordered_set<Instruction *> removed(removals.begin(), removals.end());
 
-            int offsetToNonStub = 0;
-            while (dynamic_cast<Stub *>(instructions.getInstructions()[++offsetToNonStub + i])) {
-                if (i + offsetToNonStub == instructions.getInstructions().size()) return false;
+    for (auto const &ins : instructions.getInstructions()) { // the removed ones are still linked, so they can be skipped
+        if (auto jumpInstruction = dynamic_cast<Jump *>(ins)) {
+            while (jumpInstruction->target && removed.count(jumpInstruction->target)) {
+                jumpInstruction->target = nextNonStub(jumpInstruction->target);
             }
+        }
+    }
 
-            if (auto loadiInstruction = dynamic_cast<Loadi *>(instructions.getInstructions()[i + offsetToNonStub])) {
+    for (auto const &instruction : removals) {
+        instructions.remove(instruction);
+    }
+}
+
+namespace {
+    /**
+     * A set of memory cells, by their indices in the liveness analysis.
+     */
+    class CellSet {
+    public:
+        std::vector<unsigned long long> words;
+
+        explicit CellSet(size_t cells) : words((cells + 63) / 64, 0) {}
 
-                if (storeInstruction->address.getAddress() == loadiInstruction->address.getAddress()) {
+        bool contains(size_t cell) const { return words[cell / 64] >> (cell % 64) & 1; }
 
-                    bool canRemove = true;
-                    for (int j = 0; j < instructions.getInstructions().size(); j++) {
-                        if (auto jumpInstruction = dynamic_cast<Jump *>(instructions.getInstructions()[j])) {
-                            if (jumpInstruction->target->getAddress() == loadiInstruction->getAddress() || jumpInstruction->target->getAddress() == storeInstruction->getAddress()) {
-                                canRemove = false;
-                                break;
-                            }
-                        }
-                    }
+        void add(size_t cell) { words[cell / 64] |= 1ULL << (cell % 64); }
 
-                    if (canRemove) {
-                        instructions.getInstructions().erase(instructions.getInstructions().begin() + i);
-                        instructions.getInstructions()[i + offsetToNonStub - 1] = new Loadi(*new ResolvableAddress(0));
+        void remove(size_t cell) { words[cell / 64] &= ~(1ULL << (cell % 64)); }
 
-                        return true;
-                    }
+        void addAll() { std::fill(words.begin(), words.end(), ~0ULL); }
+
+        void add(const CellSet &other) {
+            for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i];
+        }
+    };
+}
+
+long long PeepholeOptimizer::removeDeadStores() {
+    ControlFlowGraph graph(instructions);
+
+    // A cell stored only once, in the entry block, and read in another block (a constant, mostly) is read after that
+    // store on some path, and nothing else writes it: its store is live and the cell needn't be tracked. Without
+    // this, programs with many constants would have a set of all of them at every block.
+    std::unordered_map<long long, std::pair<long long, bool>> uses; // weighed stores, read outside the entry
+    BasicBlock *entry = graph.reversePostorder.empty() ? nullptr : graph.reversePostorder[0];
+    for (const auto &block : graph.reversePostorder) {
+        for (Instruction *ins = block->first;; ins = ins->next) {
+            if (auto addressed = dynamic_cast<InstructionUsingAddress *>(ins)) {
+                auto &cellUses = uses[addressed->address.getAddress()];
+                if (dynamic_cast<Store *>(ins)) {
+                    cellUses.first += block == entry ? 1 : 2; // 1 only for a single store, in the entry
+                } else if (block != entry) {
+                    cellUses.second = true;
                 }
             }
+            if (ins == block->last) break;
         }
+    }
 
+    std::unordered_map<long long, size_t> cellIndices; // only cells named by instructions; LOADI/STOREI reach the rest
+    for (const auto &cellUses : uses) {
+        if (cellUses.second.first != 1 || !cellUses.second.second) cellIndices.emplace(cellUses.first, cellIndices.size());
     }
 
-    return false;
-}
\ No newline at end of file
+    auto transfer = [&cellIndices](Instruction *instruction, CellSet &live) { // live after the instruction -> live before it
+        if (instruction->stub) return;
+        auto addressed = dynamic_cast<InstructionUsingAddress *>(instruction);
+        if (!addressed) return;
+
+        auto index = cellIndices.find(addressed->address.getAddress());
+        if (index == cellIndices.end()) {
+            if (dynamic_cast<Loadi *>(instruction)) live.addAll();
+            return;
+        }
+
+        size_t cell = index->second;
+        if (dynamic_cast<Store *>(instruction)) {
+            live.remove(cell);
+        } else if (dynamic_cast<Loadi *>(instruction)) {
+            live.addAll();
+        } else {
+            live.add(cell); // LOAD, ADD, SUB, SHIFT read the cell, STOREI reads the pointer in it
+        }
+    };
+
+    std::vector<CellSet> liveIn(graph.blocks.size(), CellSet(cellIndices.size()));
+
+    auto liveOut = [&](BasicBlock *block) {
+        CellSet live(cellIndices.size());
+        for (const auto &successor : block->successors) {
+            live.add(liveIn[successor->id]);
+        }
+        return live;
+    };
+
+    bool changed = true;
+    while (changed) { // the sets only grow, so this settles
+        changed = false;
+        for (auto block = graph.reversePostorder.rbegin(); block != graph.reversePostorder.rend(); block++) {
+            CellSet live = liveOut(*block);
+            for (Instruction *ins = (*block)->last;; ins = ins->previous) {
+                transfer(ins, live);
+                if (ins == (*block)->first) break;
+            }
+
+            if (live.words != liveIn[(*block)->id].words) {
+                liveIn[(*block)->id].words.swap(live.words);
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<Instruction *> dead;
+    for (const auto &block : graph.reversePostorder) {
+        CellSet live = liveOut(block);
+        for (Instruction *ins = block->last;; ins = ins->previous) {
+            auto storeInstruction = dynamic_cast<Store *>(ins);
+            auto index = storeInstruction ? cellIndices.find(storeInstruction->address.getAddress()) : cellIndices.end();
+            if (storeInstruction && storeInstruction->address.getAddress() != 0
+                && index != cellIndices.end() && !live.contains(index->second)) {
+                dead.push_back(storeInstruction); // the cell is dead before it as well
+            } else {
+                transfer(ins, live);
+            }
+            if (ins == block->first) break;
+        }
+    }
+
+    removeAll(dead);
+    if (verbose) {
+        for (size_t i = 0; i < dead.size(); i++) Diagnostics::out() << std::endl << "Removed dead STORE";
+    }
+
+    return dead.size();
+}
+
+long long PeepholeOptimizer::removeUselessStoreLoadis() {
+    long long removed = 0;
+
+    std::vector<Store *> worklist;
+    for (auto const &ins : instructions.getInstructions()) {
+        if (auto storeInstruction = dynamic_cast<Store *>(ins)) {
+            worklist.push_back(storeInstruction);
+        }
+    }
+    std::reverse(worklist.begin(), worklist.end()); // visit in program order
+
+    while (!worklist.empty()) {
+        Store *storeInstruction = worklist.back();
+        worklist.pop_back();
+
+        auto loadiInstruction = dynamic_cast<Loadi *>(nextNonStub(storeInstruction));
+        if (!loadiInstruction) continue;
+        if (storeInstruction->address.getAddress() != loadiInstruction->address.getAddress()) continue;
+        if (isJumpTarget(loadiInstruction) || isJumpTarget(storeInstruction)) continue;
+
+        Instruction *previous = previousNonStub(storeInstruction);
+
+        instructions.remove(storeInstruction);
+        instructions.replace(loadiInstruction, new Loadi(*new ResolvableAddress(0)));
+        removed++;
+        if (verbose) Diagnostics::out() << std::endl << "Removed useless STORE LOADI";
+
+        // a STORE right before the removed one is now followed by the LOADI
+        if (auto previousStore = dynamic_cast<Store *>(previous)) {
+            worklist.push_back(previousStore);
+        }
+    }
+
+    return removed;
+}
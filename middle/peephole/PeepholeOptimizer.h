@@ -3,26 +3,99 @@
 
 #include "../../back/asm/asm.h"
 #include "../../back/asm/InstructionList.h"
+#include "../cfg/ControlFlowGraph.h"
+#include "../../driver/Diagnostics.h"
+#include "../../driver/Stats.h"
 
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 /**
  * An optimizer removing useless asm instructions on a
  * compiled set of them.
+ * Every pass visits the program once: jumps are indexed by their
+ * targets' addresses up front and a worklist holds only the places
+ * where a removal may have made a new pattern appear. Addresses are
+ * left as they were before the optimization until the list is sealed
+ * again, so they keep identifying instructions (and jump targets) in
+ * the meantime.
  */
 class PeepholeOptimizer {
 private:
     InstructionList &instructions;
 
     /**
-     * Removes a LOAD x instruction which follows directly
-     * a STORE x instruction as long as any jump doesn't
-     * reference it.
-     * @return True if any LOAD was removed; false otherwise.
+     * Jumps by the address of their target; a Stub shares its address
+     * with the instruction following it, so a jump to a block's end
+     * is found under the address of the first instruction after it.
      */
-    bool removeUselessStoreLoads();
+    std::unordered_map<long long, std::vector<Jump *>> jumpsByTarget;
 
-    bool removeUselessStoreLoadis();
+    bool verbose = false;
+
+    void indexJumps();
+
+    bool isJumpTarget(Instruction *instruction);
+
+    /**
+     * @return First non-Stub instruction after given one, or nullptr if
+     * there is none.
+     */
+    Instruction *nextNonStub(Instruction *instruction);
+
+    /**
+     * @return Last non-Stub instruction before given one, or nullptr if
+     * there is none.
+     */
+    Instruction *previousNonStub(Instruction *instruction);
+
+    /**
+     * Drops the blocks of code which can't be reached from the start.
+     * @return Number of instructions removed.
+     */
+    long long removeUnreachableCode();
+
+    /**
+     * Updates the set of cells (sorted) known to hold the same value as
+     * the accumulator after an instruction runs: a LOAD x or a STORE x
+     * puts x in it (STOREI keeps it, as it writes the accumulator's value
+     * too) and any other instruction changing the accumulator empties it.
+     */
+    void trackAccumulator(Instruction *instruction, std::vector<long long> &knownCells);
+
+    /**
+     * Removes LOAD x instructions run when the accumulator already holds
+     * the value of x on every path leading to them (see trackAccumulator);
+     * the sets at blocks' entries are intersections of their predecessors'
+     * ones, iterated over the control flow graph until they settle.
+     * @return Number of LOADs removed.
+     */
+    long long removeRedundantLoads();
+
+    /**
+     * Removes STORE x instructions whose value is never read: on no path
+     * from them is x read before being stored to again. Liveness of cells
+     * is computed backwards over the control flow graph; LOADI may read
+     * any cell, so it makes every cell live, and STOREI may write any cell,
+     * so it kills none. Nothing is live when the program halts.
+     * @return Number of STOREs removed.
+     */
+    long long removeDeadStores();
+
+    /**
+     * Unlinks given instructions, moving every jump to any of them onto the
+     * first instruction after it which stays; removing them one by one
+     * would leave a jump moved onto an instruction removed later behind.
+     */
+    void removeAll(const std::vector<Instruction *> &removals);
+
+    /**
+     * Replaces STORE x LOADI x with LOADI 0 as long as any jump
+     * doesn't reference either of them.
+     * @return Number of STOREs removed.
+     */
+    long long removeUselessStoreLoadis();
 public:
     PeepholeOptimizer(InstructionList &instructionList) : instructions(instructionList) {}
 